@@ -115,6 +115,18 @@ public class AcroFields {
     private boolean generateAppearances = true;
     
     private HashMap localFonts = new HashMap();
+
+	// ssteward: fonts resolved from /DA, keyed by DR font reference
+	// number or standard font name; they last as long as this object
+	private HashMap resolvedFonts = new HashMap();
+
+	// ssteward: generated appearances, keyed by getAppearanceKey();
+	// each value is {PdfIndirectReference, Integer topFirst}, so fields
+	// that look alike share one XObject.  Only text and choice fields
+	// are generated; check boxes and radio buttons just pick one of
+	// their own /AP states with /AS, and flattening shares equal states
+	// (see PdfStamperImp.shareFlatAppearance())
+	private HashMap appearanceCache = new HashMap();
     
     private float extraMarginLeft;
     private float extraMarginTop;
@@ -395,6 +407,81 @@ public class AcroFields {
         }
     }
     
+	/** ssteward: describes everything <CODE>getAppearance()</CODE> reads
+	 * from <CODE>merged</CODE>, plus the text; fields with equal keys get
+	 * identical appearances.  The widget's position doesn't matter, only
+	 * its size.
+	 */
+	String getAppearanceKey(PdfDictionary merged, String text) {
+		StringBuffer key = new StringBuffer();
+		key.append(extraMarginLeft).append(' ').append(extraMarginTop);
+		PdfName keys[] = {PdfName.FT, PdfName.FF, PdfName.DA, PdfName.MK, PdfName.Q,
+						  PdfName.BS, PdfName.BORDER, PdfName.MAXLEN, PdfName.OPT};
+		for (int k = 0; k < keys.length; ++k) {
+			key.append('|');
+			appendKey(key, merged.get(keys[k]));
+		}
+		// the /DA font's entry in /DR, rather than all of /DR
+		PdfString da = (PdfString)PdfReader.getPdfObject(merged.get(PdfName.DA));
+		if (da != null) {
+			Object dab[] = splitDAelements(da.toUnicodeString());
+			key.append('|');
+			if (dab[DA_FONT] != null) {
+				PdfDictionary font = (PdfDictionary)PdfReader.getPdfObject(merged.get(PdfName.DR));
+				if (font != null)
+					font = (PdfDictionary)PdfReader.getPdfObject(font.get(PdfName.FONT));
+				if (font != null)
+					appendKey(key, font.get(new PdfName((String)dab[DA_FONT])));
+			}
+		}
+		Rectangle box = PdfReader.getNormalizedRectangle((PdfArray)PdfReader.getPdfObject(merged.get(PdfName.RECT)));
+		key.append('|').append(box.width()).append(' ').append(box.height());
+		key.append('|').append(text);
+		return key.toString();
+	}
+
+	// ssteward: appends obj to key; indirect objects by reference
+	static void appendKey(StringBuffer key, PdfObject obj) {
+		if (obj == null) {
+			key.append('-');
+			return;
+		}
+		switch (obj.type()) {
+			case PdfObject.INDIRECT: {
+				PdfIndirectReference ref = (PdfIndirectReference)obj;
+				key.append(ref.getNumber()).append(' ').append(ref.getGeneration()).append(" R");
+				break;
+			}
+			case PdfObject.ARRAY: {
+				ArrayList ar = ((PdfArray)obj).getArrayList();
+				key.append('[');
+				for (int k = 0; k < ar.size(); ++k) {
+					appendKey(key, (PdfObject)ar.get(k));
+					key.append(' ');
+				}
+				key.append(']');
+				break;
+			}
+			case PdfObject.DICTIONARY: {
+				PdfDictionary dic = (PdfDictionary)obj;
+				ArrayList names = new ArrayList(dic.getKeys());
+				Collections.sort(names); // PdfName is Comparable
+				key.append("<<");
+				for (int k = 0; k < names.size(); ++k) {
+					PdfName name = (PdfName)names.get(k);
+					key.append(name.toString()).append(' ');
+					appendKey(key, dic.get(name));
+					key.append(' ');
+				}
+				key.append(">>");
+				break;
+			}
+			default:
+				// the type keeps (string) and /Name apart
+				key.append(obj.type()).append(':').append(obj.toString());
+		}
+	}
+
     PdfAppearance getAppearance(PdfDictionary merged, String text, String fieldName) throws IOException, DocumentException {
         topFirst = 0;
         int flags = 0;
@@ -417,10 +504,20 @@ public class AcroFields {
                         font = (PdfDictionary)PdfReader.getPdfObject(font.get(PdfName.FONT));
                         if (font != null) {
                             PdfObject po = font.get(new PdfName((String)dab[DA_FONT]));
-                            if (po != null && po.type() == PdfObject.INDIRECT)
-                                tx.setFont(new DocumentFont((PRIndirectReference)po));
+                            if (po != null && po.type() == PdfObject.INDIRECT) {
+								// ssteward: parse each DR font once per fill
+								Integer fontKey = new Integer(((PRIndirectReference)po).getNumber());
+								BaseFont bf = (BaseFont)resolvedFonts.get(fontKey);
+								if (bf == null) {
+									bf = new DocumentFont((PRIndirectReference)po);
+									resolvedFonts.put(fontKey, bf);
+								}
+                                tx.setFont(bf);
+							}
                             else {
                                 BaseFont bf = (BaseFont)localFonts.get(dab[DA_FONT]);
+                                if (bf == null)
+									bf = (BaseFont)resolvedFonts.get(dab[DA_FONT]); // ssteward
                                 if (bf == null) {
                                     String fn[] = (String[])stdFieldFontNames.get(dab[DA_FONT]);
                                     if (fn != null) {
@@ -429,6 +526,7 @@ public class AcroFields {
                                             if (fn.length > 1)
                                                 enc = fn[1];
                                             bf = BaseFont.createFont(fn[0], enc, false);
+                                            resolvedFonts.put(dab[DA_FONT], bf); // ssteward
                                             tx.setFont(bf);
                                         }
                                         catch (Exception e) {
@@ -1020,7 +1118,17 @@ public class AcroFields {
 					merged.put(PdfName.RV, rv);
                 PdfDictionary widget = (PdfDictionary)item.widgets.get(idx);
                 if (generateAppearances) {
-                    PdfAppearance app = getAppearance(merged, display, name);
+					// ssteward: reuse the appearance of a field that looks the same
+					String appKey = getAppearanceKey(merged, display);
+					Object app[] = (Object[])appearanceCache.get(appKey);
+					if (app == null) {
+						PdfAppearance tp = getAppearance(merged, display, name);
+						app = new Object[] {tp.getIndirectReference(), new Integer(topFirst)};
+						writer.releaseTemplate(tp);
+						appearanceCache.put(appKey, app);
+					}
+					else
+						topFirst = ((Integer)app[1]).intValue();
                     if (PdfName.CH.equals(type)) {
                         PdfNumber n = new PdfNumber(topFirst);
                         widget.put(PdfName.TI, n);
@@ -1032,8 +1140,7 @@ public class AcroFields {
                         widget.put(PdfName.AP, appDic);
                         merged.put(PdfName.AP, appDic);
                     }
-                    appDic.put(PdfName.N, app.getIndirectReference());
-                    writer.releaseTemplate(app);
+                    appDic.put(PdfName.N, (PdfIndirectReference)app[0]); // ssteward
                 }
                 else {
                     widget.remove(PdfName.AP);
@@ -1051,6 +1158,8 @@ public class AcroFields {
             if ((flags & PdfFormField.FF_PUSHBUTTON) != 0)
                 return true;
             PdfName v = new PdfName(value);
+            // ssteward: buttons keep the states in their /AP; nothing is
+            // generated here, so appearanceCache doesn't apply
             if ((flags & PdfFormField.FF_RADIO) == 0) {
                 for (int idx = 0; idx < item.values.size(); ++idx) {
                     ((PdfDictionary)item.values.get(idx)).put(PdfName.V, v);
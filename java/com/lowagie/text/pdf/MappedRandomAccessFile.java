@@ -0,0 +1,168 @@
+/*
+ * The contents of this file are subject to the Mozilla Public License Version 1.1
+ * (the "License"); you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the License.
+ *
+ * The Original Code is 'iText, a free JAVA-PDF library'.
+ *
+ * Alternatively, the contents of this file may be used under the terms of the
+ * LGPL license (the "GNU LIBRARY GENERAL PUBLIC LICENSE"), in which case the
+ * provisions of LGPL are applicable instead of those above.  If you wish to
+ * allow use of your version of this file only under the terms of the LGPL
+ * License and not to allow others to use your version of this file under
+ * the MPL, indicate your decision by deleting the provisions above and
+ * replace them with the notice and other provisions required by the LGPL.
+ * If you do not delete the provisions above, a recipient may use your version
+ * of this file under either the MPL or the GNU LIBRARY GENERAL PUBLIC LICENSE.
+ */
+
+package com.lowagie.text.pdf;
+
+import java.io.IOException;
+import java.io.RandomAccessFile;
+import java.nio.MappedByteBuffer;
+import java.nio.channels.FileChannel;
+
+/** Read-only file access that serves every read from memory.
+ * <P>
+ * The file is mapped into memory when the platform allows it; otherwise
+ * (mapping failed, or the file is too large to map) reads are served from
+ * a large window that is refilled from the file only when a read or seek
+ * leaves it.  Either way, the byte-at-a-time reads done by
+ * <CODE>PRTokeniser</CODE> no longer cost a system call apiece.
+ */
+class MappedRandomAccessFile {
+
+    /** Size of the read window used when the file can't be mapped. */
+    static final int WINDOW_SIZE = 0x40000;
+
+    private RandomAccessFile rf;
+    private FileChannel channel;
+    private MappedByteBuffer mapped;
+
+    // windowed fallback
+    private byte window[];
+    private long windowStart = 0;
+    private int windowLength = 0;
+
+    private long length;
+    private long pos = 0;
+
+    /** Opens <CODE>filename</CODE> for reading.
+     * @param filename the file to open
+     * @param map <CODE>false</CODE> to skip the mapping attempt and use the window
+     * @throws IOException on error
+     */
+    MappedRandomAccessFile(String filename, boolean map) throws IOException {
+        rf = new RandomAccessFile(filename, "r");
+        try {
+            length = rf.length();
+            channel = rf.getChannel();
+            if (map && length > 0 && length <= Integer.MAX_VALUE) {
+                try {
+                    mapped = channel.map(FileChannel.MapMode.READ_ONLY, 0, length);
+                }
+                catch (IOException e) {
+                    mapped = null;
+                }
+                catch (OutOfMemoryError e) { // address space exhausted
+                    mapped = null;
+                }
+            }
+            if (mapped == null)
+                window = new byte[WINDOW_SIZE];
+        }
+        catch (IOException e) {
+            close();
+            throw e;
+        }
+    }
+
+    /** Returns <CODE>true</CODE> if the whole file is mapped into memory. */
+    boolean isMapped() {
+        return mapped != null;
+    }
+
+    int read() throws IOException {
+        if (pos >= length)
+            return -1;
+        if (mapped != null)
+            return mapped.get((int)pos++) & 0xff;
+        if (pos < windowStart || pos >= windowStart + windowLength)
+            fillWindow(pos);
+        return window[(int)(pos++ - windowStart)] & 0xff;
+    }
+
+    int read(byte b[], int off, int len) throws IOException {
+        if (pos >= length)
+            return -1;
+        if (len > length - pos)
+            len = (int)(length - pos);
+        if (mapped != null) {
+            mapped.position((int)pos);
+            mapped.get(b, off, len);
+            pos += len;
+            return len;
+        }
+        int n = 0;
+        // drain what the window already holds
+        if (pos >= windowStart && pos < windowStart + windowLength) {
+            n = Math.min(len, (int)(windowStart + windowLength - pos));
+            System.arraycopy(window, (int)(pos - windowStart), b, off, n);
+            pos += n;
+        }
+        if (n < len) {
+            if (len - n >= WINDOW_SIZE) {
+                // big reads bypass the window
+                rf.seek(pos);
+                rf.readFully(b, off + n, len - n);
+                pos += len - n;
+            }
+            else {
+                fillWindow(pos);
+                System.arraycopy(window, 0, b, off + n, len - n);
+                pos += len - n;
+            }
+        }
+        return len;
+    }
+
+    private void fillWindow(long start) throws IOException {
+        int len = (int)Math.min(WINDOW_SIZE, length - start);
+        rf.seek(start);
+        rf.readFully(window, 0, len);
+        windowStart = start;
+        windowLength = len;
+    }
+
+    void seek(long pos) {
+        this.pos = pos;
+    }
+
+    long getFilePointer() {
+        return pos;
+    }
+
+    long length() {
+        return length;
+    }
+
+    /** Returns the underlying channel, positioned nowhere in particular. */
+    FileChannel getChannel() {
+        return channel;
+    }
+
+    void close() throws IOException {
+        mapped = null;
+        window = null;
+        channel = null;
+        if (rf != null) {
+            rf.close();
+            rf = null;
+        }
+    }
+}
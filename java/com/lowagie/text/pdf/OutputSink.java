@@ -0,0 +1,147 @@
+/*
+ * The contents of this file are subject to the Mozilla Public License Version 1.1
+ * (the "License"); you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the License.
+ *
+ * The Original Code is 'iText, a free JAVA-PDF library'.
+ *
+ * Alternatively, the contents of this file may be used under the terms of the
+ * LGPL license (the "GNU LIBRARY GENERAL PUBLIC LICENSE"), in which case the
+ * provisions of LGPL are applicable instead of those above.  If you wish to
+ * allow use of your version of this file only under the terms of the LGPL
+ * License and not to allow others to use your version of this file under
+ * the MPL, indicate your decision by deleting the provisions above and
+ * replace them with the notice and other provisions required by the LGPL.
+ * If you do not delete the provisions above, a recipient may use your version
+ * of this file under either the MPL or the GNU LIBRARY GENERAL PUBLIC LICENSE.
+ */
+
+
+package com.lowagie.text.pdf;
+
+import java.io.FileOutputStream;
+import java.io.IOException;
+import java.io.OutputStream;
+import java.nio.channels.FileChannel;
+
+/** The stream pdftk writes its output through.
+ * <P>
+ * <CODE>PdfWriter</CODE> emits many small writes: every dictionary token and
+ * xref line.  This collects them in one large buffer.  A write that doesn't
+ * fit goes out together with the buffered bytes in a single gathering write
+ * when the destination is a file.  It counts the bytes written, and it can
+ * sync the file to disk when it is closed.
+ */
+public class OutputSink extends OutputStream {
+
+    /** The buffer size used when none is given. */
+    public static final int DEFAULT_BUFFER_SIZE = 0x100000;
+
+    private OutputStream out;
+    private FileOutputStream file; // out, when it is a file
+    private FileChannel channel;   // and its channel
+    private byte buf[];
+    private int count = 0;
+    private long written = 0;
+    private boolean sync;
+    private boolean closed = false;
+
+    /** Wraps <CODE>out</CODE>.
+     * @param out the destination
+     * @param bufferSize the buffer size in bytes; 0 for the default
+     * @param sync if <CODE>true</CODE>, sync a file destination to disk on close
+     */
+    public OutputSink(OutputStream out, int bufferSize, boolean sync) {
+        this.out = out;
+        this.sync = sync;
+        if (out instanceof FileOutputStream) {
+            file = (FileOutputStream)out;
+            channel = file.getChannel();
+        }
+        buf = new byte[bufferSize > 0 ? bufferSize : DEFAULT_BUFFER_SIZE];
+    }
+
+    public void write(int b) throws IOException {
+        if (count == buf.length)
+            flushBuffer();
+        buf[count++] = (byte)b;
+        ++written;
+    }
+
+    public void write(byte b[], int off, int len) throws IOException {
+        if (len <= buf.length - count) {
+            System.arraycopy(b, off, buf, count, len);
+            count += len;
+        }
+        else if (channel != null) {
+            // one system call for the buffer and the new bytes
+            java.nio.ByteBuffer srcs[] = {
+                java.nio.ByteBuffer.wrap(buf, 0, count),
+                java.nio.ByteBuffer.wrap(b, off, len)};
+            while (srcs[1].hasRemaining())
+                channel.write(srcs);
+            count = 0;
+        }
+        else {
+            flushBuffer();
+            if (len < buf.length) {
+                System.arraycopy(b, off, buf, 0, len);
+                count = len;
+            }
+            else
+                out.write(b, off, len);
+        }
+        written += len;
+    }
+
+    private void flushBuffer() throws IOException {
+        if (count == 0)
+            return;
+        if (channel != null) {
+            java.nio.ByteBuffer src = java.nio.ByteBuffer.wrap(buf, 0, count);
+            while (src.hasRemaining())
+                channel.write(src);
+        }
+        else
+            out.write(buf, 0, count);
+        count = 0;
+    }
+
+    public void flush() throws IOException {
+        flushBuffer();
+        out.flush();
+    }
+
+    public void close() throws IOException {
+        if (closed)
+            return;
+        closed = true;
+        flush();
+        if (sync && file != null)
+            file.getFD().sync();
+        out.close();
+    }
+
+    /** Copies <CODE>count</CODE> bytes of <CODE>src</CODE>, starting at
+     * <CODE>position</CODE>, straight into the destination file.
+     * @return the number of bytes copied; 0 if the destination isn't a file
+     * @throws IOException on error
+     */
+    public long transferFrom(FileChannel src, long position, long count) throws IOException {
+        if (channel == null)
+            return 0;
+        flushBuffer();
+        long n = src.transferTo(position, count, channel);
+        written += n;
+        return n;
+    }
+
+    /** Returns the number of bytes written through this sink. */
+    public long getCount() {
+        return written;
+    }
+}
@@ -47,6 +47,8 @@
 package com.lowagie.text.pdf;
 import java.io.OutputStream;
 import java.io.IOException;
+import java.io.FileOutputStream;
+import java.nio.channels.FileChannel;
 
 /**
  *
@@ -160,6 +162,47 @@ public class OutputStreamCounter extends OutputStream {
         out.write(b, off, len);
     }
     
+    /** ssteward: copies <CODE>file</CODE>, from its current position to its end,
+     * to the output stream; see <CODE>writeFrom(RandomAccessFileOrArray, int)</CODE>.
+     * @param file the source
+     * @throws IOException on error
+     */
+    public void writeFrom(RandomAccessFileOrArray file) throws IOException {
+        writeFrom(file, file.length() - file.getFilePointer());
+    }
+    
+    /** ssteward: copies <CODE>length</CODE> bytes of <CODE>file</CODE>, from its
+     * current position, to the output stream.  When both are files (an
+     * <CODE>OutputSink</CODE> over a file counts) the bytes move file-to-file
+     * by <CODE>FileChannel.transferTo()</CODE>, never passing through the
+     * heap; otherwise see <CODE>RandomAccessFileOrArray.copyTo()</CODE>.
+     * @param file the source
+     * @param length the number of bytes to copy
+     * @throws IOException on error
+     */
+    public void writeFrom(RandomAccessFileOrArray file, int length) throws IOException {
+        FileChannel src = file.getChannel();
+        if (src != null && (out instanceof FileOutputStream || out instanceof OutputSink)) {
+            out.flush();
+            long pos = file.getFilePointer() + file.getStartOffset();
+            long end = pos + length;
+            while (pos < end) {
+                long n;
+                if (out instanceof OutputSink)
+                    n = ((OutputSink)out).transferFrom(src, pos, end - pos);
+                else
+                    n = src.transferTo(pos, end - pos, ((FileOutputStream)out).getChannel());
+                if (n <= 0)
+                    break; // the platform gave up, or out isn't a file; finish the slow way
+                pos += n;
+                counter += n;
+            }
+            file.seek(pos - file.getStartOffset());
+            length = (int)(end - pos);
+        }
+        file.copyTo(this, length);
+    }
+    
     public int getCounter() {
         return counter;
     }
@@ -181,17 +181,7 @@ public class PRStream extends PdfStream {
 
 	{ // ssteward (right?)
 	    // the filters to apply to this, if any
-	    ArrayList filters= new ArrayList(); {
-		PdfObject filter= this.reader.getPdfObject(this.get(PdfName.FILTER));
-		if (filter != null) {
-		    if (filter.type() == PdfObject.NAME) {
-			filters.add(filter);
-		    }
-		    else if (filter.type() == PdfObject.ARRAY) {
-			filters = ((PdfArray)filter).getArrayList();
-		    }
-		}
-	    }
+	    ArrayList filters= getFilterList();
 
 	    // apply filters to our stream data before streaming?
 	    boolean filterStream_b= 
@@ -210,51 +200,66 @@ public class PRStream extends PdfStream {
 	    }
 
 	    // apply compression to our stream data before streaming?
-	    // our stream data may be in this.bytes or in a file
-	    boolean compressStream_b=
-		( writer.compressStreams &&
-		  this.reader.getPdfObject( this.get(PdfName.DECODEPARMS) )== null && 
-		  filters.isEmpty() );
-
-	    if( compressStream_b ) { // apply compression
-		if( 0< this.offset ) { // our data is in file; pull into this.bytes
-		    RandomAccessFileOrArray file= writer.getReaderFile( this.reader );
-		    this.bytes= PdfReader.getStreamBytes( this, file ); // decrypts, too
-		}
+	    // our stream data may be in this.bytes or in a file;
+	    // PdfWriter.PdfBody may have done this for us, on another thread
+	    if( isDeflatedOnOutput( writer, filters ) ) {
+		setDeflatedBytes( deflate( getBytesToDeflate( writer ) ) );
+	    }
+	}
 
-		ByteArrayOutputStream stream= new ByteArrayOutputStream();
-		DeflaterOutputStream zip= new DeflaterOutputStream( stream );
-		zip.write( this.bytes );
-		zip.close();
-		this.bytes= stream.toByteArray();
+	// ssteward: an /EncryptMetadata false handler leaves the XMP stream be
+	boolean isMetadata= PdfName.METADATA.equals(get(PdfName.TYPE));
+	PdfEncryption crypto = null;
+	if (writer != null) { // ssteward
+	    crypto = writer.getEncryption();
+	    if (crypto != null && ((isMetadata && !crypto.isMetadataEncrypted()) || !crypto.isStreamEncrypted()))
+		crypto = null;
+	}
+	PdfEncryption decrypt= reader.getDecrypt();
+	if (decrypt != null && ((isMetadata && !decrypt.isMetadataEncrypted()) || !decrypt.isStreamEncrypted()))
+	    decrypt= null;
 
-		this.put( PdfName.FILTER, PdfName.FLATEDECODE );
-		this.setLength( this.bytes.length );
-		this.offset= -1; // indicate that we have read the stream into this.bytes
+	// ssteward: AES changes the data's length, so it can't be transcrypted
+	// from the file a buffer at a time like RC4; read it in, decrypted,
+	// just for this write
+	byte data[]= this.bytes;
+	int dataLength= this.length;
+	boolean inFile= (0 <= this.offset);
+	if (inFile && writer != null) {
+	    if ((decrypt != null && decrypt.isAes()) || (crypto != null && crypto.isAes())) {
+		RandomAccessFileOrArray file= writer.getReaderFile( this.reader );
+		boolean isOpen= file.isOpen();
+		try {
+		    data= PdfReader.getStreamBytesRaw( this, file, decrypt );
+		}
+		finally {
+		    if (!isOpen)
+			try{file.close();}catch(Exception e){}
+		}
+		dataLength= data.length;
+		inFile= false;
 	    }
 	}
 
+	PdfObject plainLength= get(PdfName.LENGTH);
+	int outLength= (crypto == null || dataLength == 0) ? dataLength : crypto.calculateStreamSize(dataLength);
+	if (outLength != length)
+	    put(PdfName.LENGTH, new PdfNumber(outLength));
         superToPdf(writer, os); // PdfDictionary.toPdf(), outputs FILTER, LENGTH, etc.
+	if (outLength != length)
+	    put(PdfName.LENGTH, plainLength);
         os.write(STARTSTREAM);
-        if (length > 0) {
-            PdfEncryption crypto = null;
-            if (writer != null) { // ssteward
-                crypto = writer.getEncryption();
-	    }
-            if (offset < 0) { // our stream data is stored in this.bytes
+        if (dataLength > 0) {
+            if (!inFile) { // our stream data is stored in this.bytes, or data
                 if (crypto == null) {
-                    os.write(bytes);
+                    os.write(data, 0, dataLength);
 		}
                 else { // encrypt and output
                     crypto.prepareKey();
-                    byte buf[] = new byte[length];
-                    System.arraycopy(bytes, 0, buf, 0, length);
-                    crypto.encryptRC4(buf);
-                    os.write(buf);
+                    os.write(crypto.encryptByteArray(data, 0, dataLength));
                 }
             }
             else { // our stream data is stored in a file
-                byte buf[] = new byte[Math.min(length, 4092)];
                 RandomAccessFileOrArray file = writer.getReaderFile(reader);
                 boolean isOpen = file.isOpen();
                 try {
@@ -262,24 +267,32 @@ public class PRStream extends PdfStream {
                     int size = length;
 
                     //added by ujihara for decryption
-                    PdfEncryption decrypt = reader.getDecrypt();
-                    if (decrypt != null) {
-                        decrypt.setHashKey(objNum, objGen);
-                        decrypt.prepareKey();
+                    if (decrypt == null && crypto == null) {
+                        // ssteward: the bytes pass through unchanged, so copy
+                        // them file-to-file if we can, in big blocks if we can't
+                        if (os instanceof OutputStreamCounter)
+                            ((OutputStreamCounter)os).writeFrom(file, size);
+                        else
+                            file.copyTo(os, size);
                     }
-
-                    if (crypto != null)
-                        crypto.prepareKey();
-                    while (size > 0) {
-                        int r = file.read(buf, 0, Math.min(size, buf.length));
-                        size -= r;
-
-                        if (decrypt != null)
-                            decrypt.encryptRC4(buf, 0, r); //added by ujihara for decryption
+                    else {
+                        byte buf[] = new byte[Math.min(length, 0x10000)]; // ssteward: was 4092
+                        if (decrypt != null) {
+                            decrypt.setHashKey(objNum, objGen);
+                            decrypt.prepareKey();
+                        }
 
                         if (crypto != null)
-                            crypto.encryptRC4(buf, 0, r);
-                        os.write(buf, 0, r);
+                            crypto.prepareKey();
+                        while (size > 0) {
+                            int r = file.read(buf, 0, Math.min(size, buf.length));
+                            size -= r;
+
+                            // ssteward: decrypt (added by ujihara) and
+                            // re-encrypt in one pass over buf
+                            PdfEncryption.transcryptRC4(decrypt, crypto, buf, 0, r);
+                            os.write(buf, 0, r);
+                        }
                     }
                 }
                 finally {
@@ -291,6 +304,58 @@ public class PRStream extends PdfStream {
         os.write(ENDSTREAM);
     }
 
+    // ssteward: the stream's filters, as a list
+    private ArrayList getFilterList() {
+	ArrayList filters= new ArrayList();
+	PdfObject filter= this.reader.getPdfObject(this.get(PdfName.FILTER));
+	if (filter != null) {
+	    if (filter.type() == PdfObject.NAME) {
+		filters.add(filter);
+	    }
+	    else if (filter.type() == PdfObject.ARRAY) {
+		filters = ((PdfArray)filter).getArrayList();
+	    }
+	}
+	return filters;
+    }
+
+    // ssteward: will toPdf() deflate this stream for writer?
+    boolean isDeflatedOnOutput( PdfWriter writer ) {
+	return isDeflatedOnOutput( writer, getFilterList() );
+    }
+
+    private boolean isDeflatedOnOutput( PdfWriter writer, ArrayList filters ) {
+	return ( writer.compressStreams &&
+		 this.reader.getPdfObject( this.get(PdfName.DECODEPARMS) )== null && 
+		 filters.isEmpty() );
+    }
+
+    // ssteward: the plain bytes that toPdf() would deflate
+    byte[] getBytesToDeflate( PdfWriter writer ) throws IOException {
+	if( 0< this.offset ) { // our data is in file
+	    RandomAccessFileOrArray file= writer.getReaderFile( this.reader );
+	    return PdfReader.getStreamBytes( this, file ); // decrypts, too
+	}
+	return this.bytes;
+    }
+
+    // ssteward: takes deflated bytes in place of our stream data
+    void setDeflatedBytes( byte deflated[] ) {
+	this.bytes= deflated;
+	this.put( PdfName.FILTER, PdfName.FLATEDECODE );
+	this.setLength( this.bytes.length );
+	this.offset= -1; // indicate that we have read the stream into this.bytes
+    }
+
+    // ssteward: the deflate used for output; thread safe
+    static byte[] deflate( byte b[] ) throws IOException {
+	ByteArrayOutputStream stream= new ByteArrayOutputStream();
+	DeflaterOutputStream zip= new DeflaterOutputStream( stream );
+	zip.write( b );
+	zip.close();
+	return stream.toByteArray();
+    }
+
     // ssteward
     // do we know how to apply all of the filters in (ArrayList filters)?
     public static boolean allKnownFilters( PdfReader reader, ArrayList filters ) {
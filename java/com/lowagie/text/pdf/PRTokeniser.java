@@ -106,6 +106,32 @@ public class PRTokeniser {
     protected int generation;
     protected boolean hexString;
     
+    // ssteward: the bytes of the current token are collected here and only
+    // turned into a String when somebody asks for one (see getStringValue());
+    // the buffer is reused from token to token
+    protected byte tokenBuf[] = new byte[64];
+    protected int tokenLen = 0;
+    
+    // ssteward: numbers are converted as they are scanned
+    private boolean numIsInt; // an integer that fits an int
+    private boolean numIsCanonical; // ... written just as String.valueOf(int) would write it
+    private int numInt;
+    private boolean numIsExact; // numDouble is exactly what Double.valueOf() would give
+    private double numDouble;
+    
+    // the first number of a possible "n g R", saved by nextValidToken()
+    private byte savedBuf[] = new byte[32];
+    private int savedLen;
+    private boolean savedIsInt;
+    private boolean savedIsCanonical;
+    private int savedInt;
+    private boolean savedIsExact;
+    private double savedDouble;
+    
+    private static final double POW10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    
     private static final int LINE_SEGMENT_SIZE = 256;
     
     public PRTokeniser(String filename) throws IOException {
@@ -177,9 +203,72 @@ public class PRTokeniser {
     }
     
     public String getStringValue() {
+        if (stringValue == null) {
+            char chars[] = new char[tokenLen];
+            for (int k = 0; k < tokenLen; ++k)
+                chars[k] = (char)(tokenBuf[k] & 0xff);
+            stringValue = new String(chars);
+        }
         return stringValue;
     }
     
+    /**
+     * ssteward: compares the current token with <CODE>s</CODE> without
+     * creating a String for the token.
+     * @param s the value to compare, 8-bit characters only
+     * @return <CODE>true</CODE> if the token value equals <CODE>s</CODE>
+     */
+    public boolean stringValueEquals(String s) {
+        if (stringValue != null)
+            return stringValue.equals(s);
+        int len = s.length();
+        if (len != tokenLen)
+            return false;
+        for (int k = 0; k < len; ++k) {
+            if ((tokenBuf[k] & 0xff) != s.charAt(k))
+                return false;
+        }
+        return true;
+    }
+    
+    /**
+     * ssteward: returns a copy of the current token's bytes; for a name these
+     * are the decoded bytes, without the leading '/'.
+     * @return the token bytes
+     */
+    public byte[] getTokenBytes() {
+        byte b[] = new byte[tokenLen];
+        System.arraycopy(tokenBuf, 0, b, 0, tokenLen);
+        return b;
+    }
+    
+    /**
+     * ssteward: returns the name in the current TK_NAME token. The standard
+     * names come out of the <CODE>PdfName</CODE> intern table, so reading them
+     * allocates nothing.
+     * @return the name
+     */
+    public PdfName getNameValue() {
+        PdfName name = PdfName.intern(tokenBuf, tokenLen);
+        if (name != null)
+            return name;
+        return new PdfName(getStringValue());
+    }
+    
+    /**
+     * ssteward: returns the number in the current TK_NUMBER token. Integers
+     * and short reals are converted without going through a String; the
+     * number keeps the exact text it was read from.
+     * @return the number
+     */
+    public PdfNumber getNumberValue() {
+        if (numIsCanonical)
+            return new PdfNumber(numInt);
+        if (numIsExact)
+            return new PdfNumber(getTokenBytes(), numDouble);
+        return new PdfNumber(getStringValue());
+    }
+    
     public int getReference() {
         return reference;
     }
@@ -239,8 +328,8 @@ public class PRTokeniser {
     
     public void nextValidToken() throws IOException {
         int level = 0;
-        String n1 = null;
-        String n2 = null;
+        int n2 = 0;
+        String n2String = null; // set if the generation isn't a plain int
         int ptr = 0;
         while (nextToken()) {
             if (type == TK_COMMENT)
@@ -251,7 +340,7 @@ public class PRTokeniser {
                     if (type != TK_NUMBER)
                         return;
                     ptr = file.getFilePointer();
-                    n1 = stringValue;
+                    saveNumber();
                     ++level;
                     break;
                 }
@@ -259,25 +348,27 @@ public class PRTokeniser {
                 {
                     if (type != TK_NUMBER) {
                         file.seek(ptr);
-                        type = TK_NUMBER;
-                        stringValue = n1;
+                        restoreNumber();
                         return;
                     }
-                    n2 = stringValue;
+                    if (numIsInt)
+                        n2 = numInt;
+                    else
+                        n2String = getStringValue();
                     ++level;
                     break;
                 }
                 default:
                 {
-                    if (type != TK_OTHER || !stringValue.equals("R")) {
+                    if (type != TK_OTHER || !stringValueEquals("R")) {
                         file.seek(ptr);
-                        type = TK_NUMBER;
-                        stringValue = n1;
+                        restoreNumber();
                         return;
                     }
+                    restoreNumber();
+                    reference = intValue();
+                    generation = (n2String == null) ? n2 : Integer.valueOf(n2String).intValue();
                     type = TK_REF;
-                    reference = Integer.valueOf(n1).intValue();
-                    generation = Integer.valueOf(n2).intValue();
                     return;
                 }
             }
@@ -285,8 +376,94 @@ public class PRTokeniser {
         throwError("Unexpected end of file");
     }
     
+    private void saveNumber() {
+        if (savedBuf.length < tokenLen)
+            savedBuf = new byte[tokenLen];
+        System.arraycopy(tokenBuf, 0, savedBuf, 0, tokenLen);
+        savedLen = tokenLen;
+        savedIsInt = numIsInt;
+        savedIsCanonical = numIsCanonical;
+        savedInt = numInt;
+        savedIsExact = numIsExact;
+        savedDouble = numDouble;
+    }
+    
+    private void restoreNumber() {
+        type = TK_NUMBER;
+        tokenLen = 0;
+        for (int k = 0; k < savedLen; ++k)
+            appendToken(savedBuf[k]);
+        stringValue = null;
+        numIsInt = savedIsInt;
+        numIsCanonical = savedIsCanonical;
+        numInt = savedInt;
+        numIsExact = savedIsExact;
+        numDouble = savedDouble;
+    }
+    
+    private void appendToken(int ch) {
+        if (tokenLen == tokenBuf.length) {
+            byte b[] = new byte[tokenLen * 2];
+            System.arraycopy(tokenBuf, 0, b, 0, tokenLen);
+            tokenBuf = b;
+        }
+        tokenBuf[tokenLen++] = (byte)ch;
+    }
+    
+    /** Converts the TK_NUMBER in <CODE>tokenBuf</CODE> without a String. */
+    private void scanNumber() {
+        numIsInt = false;
+        numIsCanonical = false;
+        numIsExact = false;
+        int k = 0;
+        boolean negative = false;
+        if (k < tokenLen && (tokenBuf[k] == '-' || tokenBuf[k] == '+')) {
+            negative = (tokenBuf[k] == '-');
+            ++k;
+        }
+        int start = k;
+        long mantissa = 0;
+        int digits = 0;
+        int scale = -1; // digits after the '.'; -1 while there is no '.'
+        for (; k < tokenLen; ++k) {
+            int ch = tokenBuf[k];
+            if (ch == '.') {
+                if (scale >= 0)
+                    return; // not a number; let the String path complain
+                scale = 0;
+                continue;
+            }
+            if (digits > 0 || ch != '0')
+                ++digits;
+            if (digits > 15)
+                return; // may not be exact
+            mantissa = mantissa * 10 + (ch - '0');
+            if (scale >= 0)
+                ++scale;
+        }
+        if (k == start || (scale >= 0 && tokenLen - start == 1))
+            return; // just a sign, or just a '.'
+        if (scale < 0) {
+            long v = negative ? -mantissa : mantissa;
+            if (v >= Integer.MIN_VALUE && v <= Integer.MAX_VALUE) {
+                numIsInt = true;
+                numInt = (int)v;
+                numIsCanonical = (tokenBuf[0] != '+' && (tokenBuf[start] != '0' || tokenLen - start == 1)
+                    && !(negative && v == 0));
+            }
+            scale = 0;
+        }
+        if (scale < POW10.length) {
+            numDouble = mantissa / POW10[scale];
+            if (negative)
+                numDouble = -numDouble;
+            numIsExact = true;
+        }
+    }
+    
     public boolean nextToken() throws IOException {
-        StringBuffer outBuf = null;
+        boolean hasValue = false;
+        tokenLen = 0;
         stringValue = EMPTY;
         int ch = 0;
         do {
@@ -303,7 +480,7 @@ public class PRTokeniser {
                 break;
             case '/':
             {
-                outBuf = new StringBuffer();
+                hasValue = true;
                 type = TK_NAME;
                 while (true) {
                     ch = file.read();
@@ -312,7 +489,7 @@ public class PRTokeniser {
                     if (ch == '#') {
                         ch = (getHex(file.read()) << 4) + getHex(file.read());
                     }
-                    outBuf.append((char)ch);
+                    appendToken(ch);
                 }
                 backOnePosition(ch);
                 break;
@@ -330,7 +507,7 @@ public class PRTokeniser {
                     type = TK_START_DIC;
                     break;
                 }
-                outBuf = new StringBuffer();
+                hasValue = true;
                 type = TK_STRING;
                 hexString = true;
                 int v2 = 0;
@@ -347,14 +524,14 @@ public class PRTokeniser {
                         v2 = file.read();
                     if (v2 == '>') {
                         ch = v1 << 4;
-                        outBuf.append((char)ch);
+                        appendToken(ch);
                         break;
                     }
                     v2 = getHex(v2);
                     if (v2 < 0)
                         break;
                     ch = (v1 << 4) + v2;
-                    outBuf.append((char)ch);
+                    appendToken(ch);
                     v1 = file.read();
                 }
                 if (v1 < 0 || v2 < 0)
@@ -369,7 +546,7 @@ public class PRTokeniser {
                 break;
             case '(':
             {
-                outBuf = new StringBuffer();
+                hasValue = true;
                 type = TK_STRING;
                 hexString = false;
                 int nesting = 0;
@@ -455,7 +632,7 @@ public class PRTokeniser {
                     }
                     if (nesting == -1)
                         break;
-                    outBuf.append((char)ch);
+                    appendToken(ch);
                 }
                 if (ch == -1)
                     throwError("Error reading string");
@@ -463,18 +640,19 @@ public class PRTokeniser {
             }
             default:
             {
-                outBuf = new StringBuffer();
+                hasValue = true;
                 if (ch == '-' || ch == '+' || ch == '.' || (ch >= '0' && ch <= '9')) {
                     type = TK_NUMBER;
                     do {
-                        outBuf.append((char)ch);
+                        appendToken(ch);
                         ch = file.read();
                     } while (ch != -1 && ((ch >= '0' && ch <= '9') || ch == '.'));
+                    scanNumber();
                 }
                 else {
                     type = TK_OTHER;
                     do {
-                        outBuf.append((char)ch);
+                        appendToken(ch);
                         ch = file.read();
                     } while (!delims[ch + 1]);
                 }
@@ -482,13 +660,15 @@ public class PRTokeniser {
                 break;
             }
         }
-        if (outBuf != null)
-            stringValue = outBuf.toString();
+        if (hasValue)
+            stringValue = null; // made on demand by getStringValue()
         return true;
     }
     
     public int intValue() {
-        return Integer.valueOf(stringValue).intValue();
+        if (type == TK_NUMBER && numIsInt)
+            return numInt;
+        return Integer.valueOf(getStringValue()).intValue();
     }
     
     public boolean readLineSegment(byte input[]) throws IOException {
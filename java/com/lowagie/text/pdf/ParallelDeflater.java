@@ -0,0 +1,159 @@
+/*
+ * The contents of this file are subject to the Mozilla Public License Version 1.1
+ * (the "License"); you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the License.
+ *
+ * The Original Code is 'iText, a free JAVA-PDF library'.
+ *
+ * Alternatively, the contents of this file may be used under the terms of the
+ * LGPL license (the "GNU LIBRARY GENERAL PUBLIC LICENSE"), in which case the
+ * provisions of LGPL are applicable instead of those above.  If you wish to
+ * allow use of your version of this file only under the terms of the LGPL
+ * License and not to allow others to use your version of this file under
+ * the MPL, indicate your decision by deleting the provisions above and
+ * replace them with the notice and other provisions required by the LGPL.
+ * If you do not delete the provisions above, a recipient may use your version
+ * of this file under either the MPL or the GNU LIBRARY GENERAL PUBLIC LICENSE.
+ */
+
+
+package com.lowagie.text.pdf;
+
+import java.io.IOException;
+import java.util.LinkedList;
+
+/** Deflates stream data on a pool of worker threads.
+ * <P>
+ * Jobs are taken in the order they were submitted.  A thread waiting on a
+ * job nobody has started yet runs it itself, so the writer never sits idle
+ * behind a busy pool.  Each job is deflated exactly as
+ * <CODE>PRStream.deflate()</CODE> deflates it, so the output doesn't depend
+ * on which thread did the work.
+ */
+class ParallelDeflater {
+
+    /** One buffer to deflate. */
+    static class Job {
+        private byte in[];
+        private byte out[];
+        private IOException error;
+        private boolean started = false;
+        private boolean done = false;
+
+        private Job(byte in[]) {
+            this.in = in;
+        }
+
+        private void run() {
+            try {
+                out = PRStream.deflate(in);
+            }
+            catch (IOException e) {
+                error = e;
+            }
+            in = null;
+            synchronized (this) {
+                done = true;
+                notifyAll();
+            }
+        }
+
+        synchronized boolean isDone() {
+            return done;
+        }
+    }
+
+    private final LinkedList queue = new LinkedList();
+    private boolean closed = false;
+
+    /** Starts <CODE>threads</CODE> worker threads.
+     * @param threads the number of workers
+     */
+    ParallelDeflater(int threads) {
+        for (int k = 0; k < threads; ++k) {
+            Thread t = new Thread() {
+                public void run() {
+                    work();
+                }
+            };
+            t.setDaemon(true);
+            t.start();
+        }
+    }
+
+    /** Queues <CODE>b</CODE> for deflating.  <CODE>b</CODE> must not change
+     * until the job is done. */
+    Job submit(byte b[]) {
+        Job job = new Job(b);
+        synchronized (queue) {
+            queue.addLast(job);
+            queue.notify();
+        }
+        return job;
+    }
+
+    /** Returns the deflated bytes of <CODE>job</CODE>, waiting for them or
+     * deflating them on this thread if no worker has started yet.
+     * @throws IOException if deflating failed
+     */
+    byte[] get(Job job) throws IOException {
+        if (take(job))
+            job.run();
+        synchronized (job) {
+            while (!job.done) {
+                try {
+                    job.wait();
+                }
+                catch (InterruptedException e) {
+                    // keep waiting; the job is someone else's to finish
+                }
+            }
+        }
+        if (job.error != null)
+            throw job.error;
+        return job.out;
+    }
+
+    /** Lets the workers exit once the queue is empty. */
+    void close() {
+        synchronized (queue) {
+            closed = true;
+            queue.notifyAll();
+        }
+    }
+
+    private boolean take(Job job) {
+        synchronized (queue) {
+            if (job.started)
+                return false;
+            job.started = true;
+            queue.remove(job);
+            return true;
+        }
+    }
+
+    private void work() {
+        while (true) {
+            Job job;
+            synchronized (queue) {
+                while (queue.isEmpty() && !closed) {
+                    try {
+                        queue.wait();
+                    }
+                    catch (InterruptedException e) {
+                        // check again
+                    }
+                }
+                if (queue.isEmpty())
+                    return;
+                job = (Job)queue.removeFirst();
+                job.started = true;
+            }
+            job.run();
+        }
+    }
+}
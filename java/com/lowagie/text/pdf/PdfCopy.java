@@ -62,6 +62,7 @@ import com.lowagie.text.Document;
 import com.lowagie.text.DocumentException;
 
 import java.util.HashSet;
+import java.util.Arrays;
 
 /**
  * Make copies of PDF documents. Documents can be edited after reading and
@@ -85,6 +86,16 @@ public class PdfCopy extends PdfWriter {
         boolean getCopied() { return hasCopied; }
         PdfIndirectReference getRef() { return theRef; }
     };
+    /** ssteward: the first copy written of a dedup candidate; a later
+     * object with the same digest reuses it only if its key and stream
+     * bytes match this one's
+     */
+    static class DedupCopy {
+        PdfIndirectReference ref;
+        String key;
+        PRStream stream; // null unless it's a stream
+        int length; // of its stream bytes
+    };
     protected HashMap indirects;
     protected HashMap indirectMap;
     protected int currentObjectNum = 1;
@@ -110,6 +121,32 @@ public class PdfCopy extends PdfWriter {
 	};
 	protected HashMap topFormFieldReadersData; // I wish this was C++, where I could templates
 
+    /** ssteward: when <CODE>true</CODE>, each page, form XObject and tiling
+     * pattern gets a copy of only the resources its content uses, instead of
+     * its whole /Resources dictionary. Producers that share one resource
+     * dictionary across all pages otherwise make every copied page carry
+     * every font and image of the document.
+     */
+    public boolean pruneResources = false;
+
+    /** ssteward: the resource categories that content refers to by name */
+    private static final PdfName NAMED_RESOURCES[] = {PdfName.FONT, PdfName.XOBJECT,
+        PdfName.EXTGSTATE, PdfName.COLORSPACE, PdfName.PATTERN, PdfName.SHADING,
+        PdfName.PROPERTIES};
+
+    /** ssteward: when <CODE>true</CODE>, a stream, dictionary or array that
+     * matches one already written (after its references are translated) is
+     * not written again; references to it get the earlier copy, instead.
+     * Inputs made by the same program tend to carry identical fonts, images
+     * and ICC profiles, which otherwise make the output grow with each one.
+     */
+    public boolean dedupObjects = false;
+
+    protected HashMap dedupRefs = new HashMap(); // ssteward: digest -> DedupCopy
+    private SHA2Digest dedupDigest; // ssteward
+    protected int dedupCount = 0; // ssteward
+    protected long dedupSaved = 0; // ssteward
+
     /**
      * A key to allow us to hash indirect references
      */
@@ -205,12 +242,20 @@ public class PdfCopy extends PdfWriter {
 
         if (iRef != null) {
             theRef = iRef.getRef();
+            if (theRef == null) { // ssteward: a dedup candidate that refers to itself
+                theRef = iRef.theRef = body.getPdfIndirectReference();
+            }
             if (iRef.getCopied()) { // we've already copied this
                 return theRef;
             }
         }
         else {
-            theRef = body.getPdfIndirectReference();
+            // ssteward: don't number a dedup candidate until it's copied;
+            // if nothing refers to it by then, it may turn out to be a copy
+            if (dedupObjects && isDedupCandidate(PdfReader.getPdfObject(in)))
+                theRef = null;
+            else
+                theRef = body.getPdfIndirectReference();
             iRef = new IndirectReferences(theRef);
             indirects.put(key, iRef);
 		}
@@ -256,12 +301,145 @@ public class PdfCopy extends PdfWriter {
 		if( recurse_b ) {
 			iRef.setCopied();
 			PdfObject obj = copyObject((PdfObject)PdfReader.getPdfObjectRelease(in));
+			if (iRef.getRef() == null) { // ssteward: not referred to yet
+				DedupCopy copy = getDedupCopy(obj);
+				if (copy != null && copy.ref != null) { // already written
+					IndirectReferences firstRef = new IndirectReferences(copy.ref);
+					firstRef.setCopied();
+					indirects.put(key, firstRef);
+					return copy.ref;
+				}
+				theRef = iRef.theRef = body.getPdfIndirectReference();
+				if (copy != null)
+					copy.ref = theRef;
+			}
 			PdfIndirectObject theObj = addToBody(obj, theRef);
 		}
+		else if (iRef.getRef() == null) { // ssteward
+			theRef = iRef.theRef = body.getPdfIndirectReference();
+		}
 
         return theRef;
     }
     
+    /**
+     * ssteward: streams, arrays and dictionaries may be shared, except for
+     * dictionaries with a place in the document's structure (pages,
+     * annotations, fields, outline items and the like) that two copies mustn't
+     * share, even if they match
+     */
+    private static boolean isDedupCandidate(PdfObject obj) {
+        if (obj == null)
+            return false;
+        if (obj.isStream() || obj.isArray())
+            return true;
+        if (!obj.isDictionary())
+            return false;
+        PdfDictionary dic = (PdfDictionary)obj;
+        PdfObject type = PdfReader.getPdfObject(dic.get(PdfName.TYPE));
+        if (PdfName.PAGE.equals(type) || PdfName.PAGES.equals(type) || PdfName.ANNOT.equals(type)
+            || PdfName.CATALOG.equals(type) || PdfName.OUTLINES.equals(type))
+            return false;
+        for (int k = 0; k < DEDUP_EXCLUDED_KEYS.length; ++k) {
+            if (dic.contains(DEDUP_EXCLUDED_KEYS[k]))
+                return false;
+        }
+        return true;
+    }
+
+    /** ssteward: keys that mark a dictionary as part of the document's structure */
+    private static final PdfName DEDUP_EXCLUDED_KEYS[] = {PdfName.PARENT, PdfName.KIDS,
+        PdfName.P, PdfName.FT, PdfName.RECT, PdfName.FIELDS, PdfName.FIRST, PdfName.NEXT,
+        PdfName.PREV};
+
+    /**
+     * ssteward: looks up a copied object by its SHA-256 digest, for finding
+     * its duplicates; streams are digested by their dictionary (less /Length)
+     * and their decrypted, but still encoded, bytes. A digest match is
+     * checked byte for byte against the first copy. Returns the first copy
+     * if this is a duplicate, a new entry to fill in with this object's
+     * reference if it's the first, or null if its digest matched an object
+     * that differs from it. Also counts the bytes a duplicate would have taken.
+     */
+    private DedupCopy getDedupCopy(PdfObject obj) throws IOException {
+        if (dedupDigest == null)
+            dedupDigest = new SHA2Digest(256);
+        StringBuffer key = new StringBuffer();
+        byte b[] = null;
+        if (obj.isStream()) {
+            b = getDedupBytes((PRStream)obj);
+            PdfDictionary dic = new PdfDictionary();
+            dic.putAll((PRStream)obj);
+            dic.remove(PdfName.LENGTH);
+            AcroFields.appendKey(key, dic);
+            key.append('|').append(b.length);
+        }
+        else
+            AcroFields.appendKey(key, obj);
+        String keyText = key.toString();
+        dedupDigest.update(PdfEncodings.convertToBytes(keyText, PdfObject.TEXT_UNICODE));
+        if (b != null)
+            dedupDigest.update(b);
+        byte digest[] = dedupDigest.digest();
+        StringBuffer hex = new StringBuffer();
+        for (int k = 0; k < digest.length; ++k)
+            hex.append(Integer.toHexString((digest[k] & 0xff) | 0x100).substring(1));
+        String ret = hex.toString();
+        DedupCopy copy = (DedupCopy)dedupRefs.get(ret);
+        if (copy == null) {
+            copy = new DedupCopy();
+            copy.key = keyText;
+            if (b != null) {
+                copy.stream = (PRStream)obj;
+                copy.length = b.length;
+            }
+            dedupRefs.put(ret, copy);
+            return copy;
+        }
+        // the first copy's stream is read again, rather than kept in memory
+        if (!copy.key.equals(keyText) || (copy.stream == null) != (b == null))
+            return null;
+        if (b != null && (copy.length != b.length || !Arrays.equals(getDedupBytes(copy.stream), b)))
+            return null;
+        ++dedupCount;
+        dedupSaved += keyText.length() + (b == null ? 0 : b.length) + 30; // obj, endobj, xref entry
+        return copy;
+    }
+
+    /** ssteward: a stream's decrypted, but still encoded, bytes; the first
+     * copy of a duplicate may come from an earlier input, whose file
+     * getReaderFile() doesn't return and getImportedPage() has closed, so
+     * those are read through a file of the stream's own reader
+     */
+    private byte[] getDedupBytes(PRStream stream) throws IOException {
+        PdfReader streamReader = stream.getReader();
+        RandomAccessFileOrArray file;
+        if (currentPdfReaderInstance != null && currentPdfReaderInstance.getReader() == streamReader)
+            file = currentPdfReaderInstance.getReaderFile();
+        else
+            file = streamReader.getSafeFile();
+        boolean isOpen = file.isOpen();
+        try {
+            if (!isOpen)
+                file.reOpen();
+            return PdfReader.getStreamBytesRaw(stream, file, streamReader.getDecrypt());
+        }
+        finally {
+            if (!isOpen)
+                try{file.close();}catch(Exception e){}
+        }
+    }
+
+    /** ssteward: the number of duplicate objects that weren't written */
+    public int getDuplicateCount() {
+        return dedupCount;
+    }
+
+    /** ssteward: roughly how many bytes the duplicates would have taken */
+    public long getDuplicateSavings() {
+        return dedupSaved;
+    }
+
     /**
      * Translate a PRDictionary to a PdfDictionary. Also translate all of the
      * objects contained in it.
@@ -278,6 +456,8 @@ public class PdfCopy extends PdfWriter {
             if (type != null && PdfName.PAGE.equals(type)) {
                 if (key.equals(PdfName.PARENT))
                     out.put(PdfName.PARENT, topPageParent);
+                else if (pruneResources && key.equals(PdfName.RESOURCES)) // ssteward
+                    out.put(key, copyResources(value, in.get(PdfName.CONTENTS)));
                 else if (!key.equals(PdfName.B))
                     out.put(key, copyObject(value));
             }
@@ -293,15 +473,184 @@ public class PdfCopy extends PdfWriter {
     protected PdfStream copyStream(PRStream in) throws IOException, BadPdfFormatException {
         PRStream out = new PRStream(in, null);
         
+        // ssteward: forms and tiling patterns are content streams, too
+        PdfObject patternType = in.get(PdfName.PATTERNTYPE);
+        boolean prune = pruneResources && (PdfName.FORM.equals(in.get(PdfName.SUBTYPE))
+            || (patternType != null && patternType.isNumber() && ((PdfNumber)patternType).intValue() == 1));
+        
         for (Iterator it = in.getKeys().iterator(); it.hasNext();) {
             PdfName key = (PdfName) it.next();
             PdfObject value = (PdfObject)in.get(key);
-            out.put(key, copyObject(value));
+            if (prune && key.equals(PdfName.RESOURCES))
+                out.put(key, copyResources(value, in));
+            else
+                out.put(key, copyObject(value));
+        }
+        
+        return out;
+    }
+    
+    /**
+     * ssteward: copies a /Resources dictionary, keeping only the named
+     * resources that <CODE>contents</CODE> uses. Anything that isn't a named
+     * resource (e.g., /ProcSet) is copied whole, as are the resources of
+     * content that can't be read. /DefaultGray, /DefaultRGB and /DefaultCMYK
+     * in /ColorSpace are always kept: content never names them, but they
+     * stand in for the device color spaces it uses.
+     * @param res the resources, or a reference to them
+     * @param contents the content stream, or an array of content streams
+     * @return the copy
+     */
+    protected PdfObject copyResources(PdfObject res, PdfObject contents)
+    throws IOException, BadPdfFormatException {
+        PdfObject resObj = PdfReader.getPdfObject(res);
+        if (resObj == null || !resObj.isDictionary())
+            return copyObject(res);
+        PdfDictionary resources = (PdfDictionary)resObj;
+        HashSet names;
+        RandomAccessFileOrArray file = getReaderFile(reader);
+        boolean isOpen = file.isOpen();
+        try {
+            names = getUsedNames(contents, resources, file);
+        }
+        finally {
+            if (!isOpen)
+                try{file.close();}catch(Exception e){}
         }
+        if (names == null)
+            return copyObject(res);
         
+        PdfDictionary out = new PdfDictionary();
+        for (Iterator it = resources.getKeys().iterator(); it.hasNext();) {
+            PdfName key = (PdfName)it.next();
+            PdfObject value = resources.get(key);
+            PdfObject category = PdfReader.getPdfObject(value);
+            if (!isNamedResource(key) || category == null || !category.isDictionary()) {
+                out.put(key, copyObject(value));
+                continue;
+            }
+            PdfDictionary used = new PdfDictionary();
+            for (Iterator jt = ((PdfDictionary)category).getKeys().iterator(); jt.hasNext();) {
+                PdfName name = (PdfName)jt.next();
+                if (names.contains(name) || (PdfName.COLORSPACE.equals(key) && isDefaultColorSpace(name)))
+                    used.put(name, copyObject(((PdfDictionary)category).get(name)));
+            }
+            if (used.size() > 0)
+                out.put(key, used);
+        }
         return out;
     }
     
+    /** ssteward: a color space that stands in for a device color space */
+    private static boolean isDefaultColorSpace(PdfName name) {
+        return PdfName.DEFAULTGRAY.equals(name) || PdfName.DEFAULTRGB.equals(name)
+            || PdfName.DEFAULTCMYK.equals(name);
+    }
+    
+    private static boolean isNamedResource(PdfName key) {
+        for (int k = 0; k < NAMED_RESOURCES.length; ++k) {
+            if (NAMED_RESOURCES[k].equals(key))
+                return true;
+        }
+        return false;
+    }
+    
+    /**
+     * ssteward: the names that <CODE>contents</CODE> uses as operands.
+     * Form XObjects and Type 3 fonts without resources of their own use
+     * their user's, so the names in their content count, too.
+     * @param contents the content stream, or an array of content streams
+     * @param resources the resources the content uses
+     * @param file the current reader's file
+     * @return the set of names, or <CODE>null</CODE> if they can't be found
+     */
+    private HashSet getUsedNames(PdfObject contents, PdfDictionary resources, RandomAccessFileOrArray file) {
+        HashSet names = new HashSet();
+        try {
+            if (!addContentNames(contents, names, file))
+                return null;
+            
+            PdfDictionary xobjects = (PdfDictionary)PdfReader.getPdfObject(resources.get(PdfName.XOBJECT));
+            PdfDictionary fonts = (PdfDictionary)PdfReader.getPdfObject(resources.get(PdfName.FONT));
+            HashSet visited = new HashSet();
+            boolean more = true;
+            while (more) { // a form's names may name another form
+                more = false;
+                for (Iterator it = new ArrayList(names).iterator(); it.hasNext();) {
+                    PdfName name = (PdfName)it.next();
+                    if (visited.contains(name))
+                        continue;
+                    visited.add(name);
+                    PdfObject xobject = (xobjects == null) ? null : PdfReader.getPdfObject(xobjects.get(name));
+                    if (xobject != null && xobject.isStream()
+                        && PdfName.FORM.equals(((PdfDictionary)xobject).get(PdfName.SUBTYPE))
+                        && !((PdfDictionary)xobject).contains(PdfName.RESOURCES)) {
+                        if (!addContentNames(xobject, names, file))
+                            return null;
+                        more = true;
+                    }
+                    PdfObject font = (fonts == null) ? null : PdfReader.getPdfObject(fonts.get(name));
+                    if (font != null && font.isDictionary()
+                        && PdfName.TYPE3.equals(PdfReader.getPdfObject(((PdfDictionary)font).get(PdfName.SUBTYPE)))
+                        && !((PdfDictionary)font).contains(PdfName.RESOURCES))
+                        return null; // its glyphs' names are too much trouble to follow
+                }
+            }
+        }
+        catch (Exception e) {
+            return null;
+        }
+        return names;
+    }
+    
+    /**
+     * ssteward: adds the names used in the content stream(s) to
+     * <CODE>names</CODE>
+     * @return <CODE>false</CODE> if some content isn't a stream we can read
+     */
+    private boolean addContentNames(PdfObject contents, HashSet names, RandomAccessFileOrArray file) throws IOException {
+        contents = PdfReader.getPdfObject(contents);
+        if (contents == null)
+            return true;
+        if (contents.isArray()) {
+            ArrayList list = ((PdfArray)contents).getArrayList();
+            for (int k = 0; k < list.size(); ++k) {
+                if (!addContentNames((PdfObject)list.get(k), names, file))
+                    return false;
+            }
+            return true;
+        }
+        if (!(contents instanceof PRStream) || ((PRStream)contents).getReader() != reader)
+            return false;
+        
+        PRTokeniser tokens = new PRTokeniser(PdfReader.getStreamBytes((PRStream)contents, file));
+        while (tokens.nextToken()) {
+            int type = tokens.getTokenType();
+            if (type == PRTokeniser.TK_NAME)
+                names.add(tokens.getNameValue());
+            else if (type == PRTokeniser.TK_OTHER && tokens.stringValueEquals("ID"))
+                skipInlineImage(tokens);
+        }
+        return true;
+    }
+    
+    /** ssteward: skips an inline image's data, up to and including its EI */
+    private static void skipInlineImage(PRTokeniser tokens) throws IOException {
+        int prev2 = tokens.read(); // the white space after ID
+        int prev = tokens.read();
+        int ch;
+        while ((ch = tokens.read()) != -1) {
+            if (prev == 'E' && ch == 'I' && PRTokeniser.isWhitespace(prev2)) {
+                int next = tokens.read();
+                if (next == -1 || PRTokeniser.isWhitespace(next))
+                    return;
+                tokens.backOnePosition(next);
+            }
+            prev2 = prev;
+            prev = ch;
+        }
+    }
+    
     
     /**
      * Translate a PRArray to a PdfArray. Also translate all of the objects contained
@@ -406,6 +755,17 @@ public class PdfCopy extends PdfWriter {
             iRef = new IndirectReferences(pageRef);
             indirects.put(key, iRef);
         }
+        // ssteward: this page was already written, so emit a clone
+        // that shares its contents and resources; see isPageClonable()
+        if (iRef.getCopied() && isPageClonable(reader, pageNum)) {
+            pageRef = body.getPdfIndirectReference();
+            addPageClone(thePage, pageRef);
+            pageReferences.add(pageRef);
+            ++currentPageNumber;
+            root.addPage(pageRef);
+            pageNumbersToRefs.add(pageRef);
+            return;
+        }
         pageReferences.add(pageRef);
         ++currentPageNumber;
         if (! iRef.getCopied()) {
@@ -531,6 +891,7 @@ public class PdfCopy extends PdfWriter {
 
 												// wire annot and new parent together
 												annot.put( PdfName.PARENT, new_parent_ref );
+												reader.pinPdfObject( annot_ref ); // partial readers must keep our edit
 												new_parent_kids.add( annot_ref ); // the new parent must point at the field, too
 
 												// tally full field name
@@ -639,6 +1000,68 @@ public class PdfCopy extends PdfWriter {
         pageNumbersToRefs.add(pageRef);
     }
     
+    /**
+     * ssteward: returns <CODE>true</CODE> if the page can be added more than once
+     * from the same reader. The first addPage() writes the page and its
+     * resources; later calls write only a fresh page dictionary (and fresh
+     * copies of its annotations) that refers to the same resources and content.
+     * Pages with form fields or popup annotations can't be cloned this way,
+     * because those objects point back at a single page or field; callers
+     * should use another reader for repeats of such pages.
+     * @param reader the reader of the document
+     * @param pageNum the page number, 1-based
+     * @return <CODE>true</CODE> if the page may be cloned
+     */
+    public static boolean isPageClonable(PdfReader reader, int pageNum) {
+        PdfDictionary page = reader.getPageNRelease(pageNum);
+        if (page == null)
+            return false;
+        PdfObject annots_obj = PdfReader.getPdfObject(page.get(PdfName.ANNOTS));
+        if (annots_obj == null || !annots_obj.isArray())
+            return true;
+        ArrayList annots_arr = ((PdfArray)annots_obj).getArrayList();
+        for (int ii = 0; ii < annots_arr.size(); ++ii) {
+            PdfObject annot_obj = PdfReader.getPdfObject((PdfObject)annots_arr.get(ii));
+            if (annot_obj == null || !annot_obj.isDictionary())
+                continue;
+            PdfDictionary annot = (PdfDictionary)annot_obj;
+            PdfObject subtype = PdfReader.getPdfObject(annot.get(PdfName.SUBTYPE));
+            if (PdfName.WIDGET.equals(subtype) || PdfName.POPUP.equals(subtype))
+                return false;
+            if (annot.contains(PdfName.PARENT) || annot.contains(PdfName.POPUP))
+                return false;
+        }
+        return true;
+    }
+
+    /**
+     * ssteward: write a second (third, ...) instance of a page that was already
+     * copied from the current reader; everything the page refers to resolves
+     * to the objects written the first time, so only the page dictionary and
+     * its annotations are new
+     */
+    protected void addPageClone(PdfDictionary thePage, PdfIndirectReference pageRef)
+    throws IOException, BadPdfFormatException {
+        PdfDictionary newPage = copyDictionary(thePage);
+        PdfObject annots_obj = PdfReader.getPdfObject(thePage.get(PdfName.ANNOTS));
+        if (annots_obj != null && annots_obj.isArray()) {
+            PdfArray newAnnots = new PdfArray();
+            ArrayList annots_arr = ((PdfArray)annots_obj).getArrayList();
+            for (int ii = 0; ii < annots_arr.size(); ++ii) {
+                PdfObject annot_obj = PdfReader.getPdfObject((PdfObject)annots_arr.get(ii));
+                if (annot_obj == null || !annot_obj.isDictionary())
+                    continue;
+                PdfDictionary newAnnot = copyDictionary((PdfDictionary)annot_obj);
+                if (newAnnot.contains(PdfName.P))
+                    newAnnot.put(PdfName.P, pageRef);
+                newAnnots.add(addToBody(newAnnot).getIndirectReference());
+            }
+            newPage.put(PdfName.ANNOTS, newAnnots);
+        }
+        newPage.put(PdfName.PARENT, topPageParent);
+        addToBody(newPage, pageRef);
+    }
+
     public PdfIndirectReference getPageReference(int page) {
         if (page < 0 || page > pageNumbersToRefs.size())
             throw new IllegalArgumentException("Invalid page number " + page);
@@ -63,13 +63,22 @@ public class PdfEncryption {
         (byte)0x2F, (byte)0x0C, (byte)0xA9, (byte)0xFE, (byte)0x64, (byte)0x53,
         (byte)0x69, (byte)0x7A};
         
-    byte state[] = new byte[256];
+    // ssteward: ints, so the RC4 loops needn't mask off sign extension
+    int state[] = new int[256];
     int x;
     int y;
     /** The encryption key for a particular object/generation */
     byte key[];
     /** The encryption key length for a particular object/generation */
     int keySize;
+    // ssteward: the object/generation key was made for, so the strings and
+    // stream of one object needn't each rehash it; keyNumber < 0 if none
+    private int keyNumber = -1;
+    private int keyGeneration;
+    // ssteward: the RC4 state right after scheduling key, so prepareKey()
+    // can restore it instead of scheduling again
+    private int keyState[] = new int[256];
+    private boolean keyStateValid = false;
     /** The global encryption key */
     byte mkey[];
     /** Work area to prepare the object/generation bytes */
@@ -83,6 +92,25 @@ public class PdfEncryption {
     int permissions;
     byte documentID[];
     static long seq = System.currentTimeMillis();
+    // ssteward: the security handler revision (2, 3, 4, 5 or 6); whether
+    // strings and streams use AES rather than RC4; and, for revision 4 and
+    // up, whether the XMP metadata stream is encrypted too
+    int revision;
+    boolean aes = false;
+    boolean encryptMetadata = true;
+    // ssteward: false when a revision 4 to 6 handler's /StmF or /StrF is
+    // /Identity, which leaves streams or strings as they are
+    boolean encryptStreams = true;
+    boolean encryptStrings = true;
+    /** ssteward: the revision 5 and 6 O, U and Perms entries' companions */
+    byte oeKey[];
+    byte ueKey[];
+    byte perms[];
+    /** ssteward: the AES cipher for key, made when first needed */
+    private AESCipher keyCipher;
+    static final byte salt[] = {(byte)0x73, (byte)0x41, (byte)0x6c, (byte)0x54}; // "sAlT"
+    private static AESCipher randomCipher;
+    private static long randomCounter;
 
     public PdfEncryption() {
         try {
@@ -101,6 +129,54 @@ public class PdfEncryption {
         permissions = enc.permissions;
         if (enc.documentID != null)
             documentID = (byte[])enc.documentID.clone();
+        revision = enc.revision; // ssteward
+        aes = enc.aes;
+        encryptMetadata = enc.encryptMetadata;
+        encryptStreams = enc.encryptStreams;
+        encryptStrings = enc.encryptStrings;
+        if (enc.oeKey != null)
+            oeKey = (byte[])enc.oeKey.clone();
+        if (enc.ueKey != null)
+            ueKey = (byte[])enc.ueKey.clone();
+        if (enc.perms != null)
+            perms = (byte[])enc.perms.clone();
+    }
+
+    /** ssteward: sets the handler revision and crypt method before the keys
+     * are set up from a document's encryption dictionary
+     */
+    public void setCryptoMode(int revision, boolean aes, boolean encryptMetadata) {
+        this.revision = revision;
+        this.aes = aes;
+        this.encryptMetadata = encryptMetadata;
+    }
+
+    public int getRevision() {
+        return revision;
+    }
+
+    public boolean isAes() {
+        return aes;
+    }
+
+    public boolean isMetadataEncrypted() {
+        return encryptMetadata;
+    }
+    
+    /** ssteward: sets which of streams and strings the crypt filters
+     * encrypt; an /Identity filter leaves its kind as it is
+     */
+    public void setCryptFilters(boolean encryptStreams, boolean encryptStrings) {
+        this.encryptStreams = encryptStreams;
+        this.encryptStrings = encryptStrings;
+    }
+    
+    public boolean isStreamEncrypted() {
+        return encryptStreams;
+    }
+    
+    public boolean isStringEncrypted() {
+        return encryptStrings;
     }
     
     /**
@@ -154,6 +230,9 @@ public class PdfEncryption {
         this.ownerKey = ownerKey;
         this.permissions = permissions;
         mkey = new byte[strength128Bits ? 16 : 5];
+        keyNumber = -1; // ssteward
+        keyStateValid = false;
+        keyCipher = null;
 
         //fixed by ujihara in order to follow PDF refrence
         md5.reset();
@@ -167,6 +246,11 @@ public class PdfEncryption {
         ext[3] = (byte)(permissions >> 24);
         md5.update(ext, 0, 4);
         if (documentID != null) md5.update(documentID);
+        if (revision >= 4 && !encryptMetadata) { // ssteward
+            for (int k = 0; k < 4; ++k)
+                ext[k] = (byte)0xff;
+            md5.update(ext, 0, 4);
+        }
 
         byte digest[] = md5.digest();
 
@@ -203,6 +287,33 @@ public class PdfEncryption {
     }
 
     public void setupAllKeys(byte userPassword[], byte ownerPassword[], int permissions, boolean strength128Bits) {
+        setupAllKeys(userPassword, ownerPassword, permissions, strength128Bits ? PdfWriter.STANDARD_ENCRYPTION_128 : PdfWriter.STANDARD_ENCRYPTION_40);
+    }
+
+    /** ssteward: as above, with <CODE>encryptionType</CODE> one of
+     * <CODE>PdfWriter.STANDARD_ENCRYPTION_40</CODE>, <CODE>STANDARD_ENCRYPTION_128</CODE>,
+     * <CODE>ENCRYPTION_AES_128</CODE> or <CODE>ENCRYPTION_AES_256</CODE>
+     */
+    public void setupAllKeys(byte userPassword[], byte ownerPassword[], int permissions, int encryptionType) {
+        if (userPassword == null)
+            userPassword = new byte[0];
+        boolean strength128Bits = (encryptionType != PdfWriter.STANDARD_ENCRYPTION_40);
+        switch (encryptionType) {
+            case PdfWriter.STANDARD_ENCRYPTION_40:
+                setCryptoMode(2, false, true);
+                break;
+            case PdfWriter.STANDARD_ENCRYPTION_128:
+                setCryptoMode(3, false, true);
+                break;
+            case PdfWriter.ENCRYPTION_AES_128:
+                setCryptoMode(4, true, true);
+                break;
+            case PdfWriter.ENCRYPTION_AES_256:
+                setCryptoMode(6, true, true);
+                break;
+            default:
+                throw new IllegalArgumentException("Unknown encryption type: " + encryptionType);
+        }
 	// ssteward: this 'random' owner PW is generally unexpected behavior
 	// and could lead to unpleasant surprises; as noted, below,
 	// if no owner password is given, use the user password in its place;
@@ -215,6 +326,11 @@ public class PdfEncryption {
 	// PDF 1.3 ref. (40 bit enc.) says to set unused, upper bits to 1
         permissions |= strength128Bits ? 0xfffff0c0 : 0xffffffc0;
         permissions &= 0xfffffffc;
+        if (revision >= 5) {
+            documentID = createDocumentId();
+            setupAllKeysAES256(userPassword, ownerPassword, permissions);
+            return;
+        }
         //PDF refrence 3.5.2 Standard Security Handler, Algorithum 3.3-1
         //If there is no owner password, use the user password instead.
         byte userPad[] = padPassword(userPassword);
@@ -264,11 +380,227 @@ public class PdfEncryption {
         setupUserKey();
     }
 
+    /** ssteward: the revision 5 and 6 password hash; for revision 6 this is
+     * algorithm 2.B of ISO 32000-2, for revision 5 a plain SHA-256
+     * @param password the password; no more than 127 bytes of it are used
+     * @param salt holds the 8 byte salt at <CODE>saltOff</CODE>
+     * @param udata the 48 byte U value when hashing the owner password, else <CODE>null</CODE>
+     * @return the 32 byte hash
+     */
+    private byte[] hashAES256(byte password[], byte salt[], int saltOff, byte udata[]) {
+        int pwLength = (password == null) ? 0 : Math.min(password.length, 127);
+        int udLength = (udata == null) ? 0 : 48;
+        SHA2Digest sha256 = new SHA2Digest(256);
+        if (pwLength > 0)
+            sha256.update(password, 0, pwLength);
+        sha256.update(salt, saltOff, 8);
+        if (udLength > 0)
+            sha256.update(udata, 0, udLength);
+        byte k[] = sha256.digest();
+        if (revision == 5)
+            return k;
+        SHA2Digest sha384 = null;
+        SHA2Digest sha512 = null;
+        for (int round = 1; ; ++round) {
+            // the password, k and udata, 64 times over, encrypted in one pass
+            int seqLength = pwLength + k.length + udLength;
+            byte e[] = new byte[seqLength * 64];
+            if (pwLength > 0)
+                System.arraycopy(password, 0, e, 0, pwLength);
+            System.arraycopy(k, 0, e, pwLength, k.length);
+            if (udLength > 0)
+                System.arraycopy(udata, 0, e, pwLength + k.length, udLength);
+            for (int j = 1; j < 64; ++j)
+                System.arraycopy(e, 0, e, j * seqLength, seqLength);
+            new AESCipher(k, 0, 16).encryptCBC(k, 16, e, 0, e.length);
+            // the first 16 bytes as a number, mod 3, is their sum mod 3
+            int sum = 0;
+            for (int j = 0; j < 16; ++j)
+                sum += e[j] & 0xff;
+            switch (sum % 3) {
+                case 0:
+                    sha256.update(e);
+                    k = sha256.digest();
+                    break;
+                case 1:
+                    if (sha384 == null)
+                        sha384 = new SHA2Digest(384);
+                    sha384.update(e);
+                    k = sha384.digest();
+                    break;
+                default:
+                    if (sha512 == null)
+                        sha512 = new SHA2Digest(512);
+                    sha512.update(e);
+                    k = sha512.digest();
+                    break;
+            }
+            if (round >= 64 && (e[e.length - 1] & 0xff) <= round - 32)
+                break;
+        }
+        if (k.length == 32)
+            return k;
+        byte hash[] = new byte[32];
+        System.arraycopy(k, 0, hash, 0, 32);
+        return hash;
+    }
+
+    /** ssteward: encrypts or decrypts the 32 byte file key with AES-256,
+     * no IV and no padding, as the OE and UE entries hold it
+     */
+    private static byte[] wrapKeyAES256(byte hash[], byte fileKey[], boolean encrypt) {
+        AESCipher cipher = new AESCipher(hash, 0, 32);
+        byte iv[] = new byte[16];
+        byte out[] = new byte[32];
+        if (encrypt) {
+            System.arraycopy(fileKey, 0, out, 0, 32);
+            cipher.encryptCBC(iv, 0, out, 0, 32);
+        }
+        else
+            cipher.decryptCBC(iv, 0, fileKey, 0, 32, out, 0);
+        return out;
+    }
+
+    /** ssteward: the revision 6 keys for a new document; the file key is
+     * random, and U and O each carry their own validation and key salts
+     */
+    private void setupAllKeysAES256(byte userPassword[], byte ownerPassword[], int permissions) {
+        this.permissions = permissions;
+        mkey = new byte[32];
+        randomBytes(mkey, 0, 32);
+        keyNumber = -1;
+        keyStateValid = false;
+        keyCipher = null;
+
+        userKey = new byte[48];
+        randomBytes(userKey, 32, 16);
+        System.arraycopy(hashAES256(userPassword, userKey, 32, null), 0, userKey, 0, 32);
+        ueKey = wrapKeyAES256(hashAES256(userPassword, userKey, 40, null), mkey, true);
+
+        ownerKey = new byte[48];
+        randomBytes(ownerKey, 32, 16);
+        System.arraycopy(hashAES256(ownerPassword, ownerKey, 32, userKey), 0, ownerKey, 0, 32);
+        oeKey = wrapKeyAES256(hashAES256(ownerPassword, ownerKey, 40, userKey), mkey, true);
+
+        perms = new byte[16];
+        for (int k = 0; k < 4; ++k)
+            perms[k] = (byte)(permissions >> (8 * k));
+        for (int k = 4; k < 8; ++k)
+            perms[k] = (byte)0xff;
+        perms[8] = (byte)(encryptMetadata ? 'T' : 'F');
+        perms[9] = (byte)'a';
+        perms[10] = (byte)'d';
+        perms[11] = (byte)'b';
+        randomBytes(perms, 12, 4);
+        new AESCipher(mkey, 0, 32).encryptBlock(perms, 0, perms, 0);
+    }
+
+    /** ssteward: sets up the revision 5 or 6 file key from the owner
+     * password, if it is the owner password
+     * @return <CODE>false</CODE> if it isn't
+     */
+    public boolean setupByOwnerPasswordAES256(byte[] documentID, byte ownerPassword[], byte uValue[], byte oValue[], byte ueValue[], byte oeValue[], int permissions) {
+        if (uValue.length < 48 || oValue.length < 48 || oeValue == null || oeValue.length < 32)
+            return false;
+        byte udata[] = new byte[48];
+        System.arraycopy(uValue, 0, udata, 0, 48);
+        if (!equalsArray(hashAES256(ownerPassword, oValue, 32, udata), oValue, 32))
+            return false;
+        setupByHashAES256(documentID, hashAES256(ownerPassword, oValue, 40, udata), oeValue, uValue, oValue, ueValue, oeValue, permissions);
+        return true;
+    }
+
+    /** ssteward: sets up the revision 5 or 6 file key from the user
+     * password, if it is the user password
+     * @return <CODE>false</CODE> if it isn't
+     */
+    public boolean setupByUserPasswordAES256(byte[] documentID, byte userPassword[], byte uValue[], byte oValue[], byte ueValue[], byte oeValue[], int permissions) {
+        if (uValue.length < 48 || ueValue == null || ueValue.length < 32)
+            return false;
+        if (!equalsArray(hashAES256(userPassword, uValue, 32, null), uValue, 32))
+            return false;
+        setupByHashAES256(documentID, hashAES256(userPassword, uValue, 40, null), ueValue, uValue, oValue, ueValue, oeValue, permissions);
+        return true;
+    }
+
+    private void setupByHashAES256(byte[] documentID, byte hash[], byte wrappedKey[], byte uValue[], byte oValue[], byte ueValue[], byte oeValue[], int permissions) {
+        this.documentID = documentID;
+        this.permissions = permissions;
+        userKey = uValue;
+        ownerKey = oValue;
+        ueKey = ueValue;
+        oeKey = oeValue;
+        mkey = wrapKeyAES256(hash, wrappedKey, false);
+        keyNumber = -1;
+        keyStateValid = false;
+        keyCipher = null;
+    }
+
+    private static boolean equalsArray(byte ar1[], byte ar2[], int size) {
+        for (int k = 0; k < size; ++k) {
+            if (ar1[k] != ar2[k])
+                return false;
+        }
+        return true;
+    }
+
+    /** ssteward: fills <CODE>b</CODE> with random bytes, for IVs, salts and
+     * file keys: AES-256 over a counter, keyed from <CODE>SecureRandom</CODE>
+     * (and the sources <CODE>createDocumentId()</CODE> draws on, should
+     * <CODE>SecureRandom</CODE> be missing)
+     */
+    static synchronized void randomBytes(byte b[], int off, int len) {
+        if (randomCipher == null) {
+            byte seed[] = new byte[32];
+            try {
+                new java.security.SecureRandom().nextBytes(seed);
+            }
+            catch (Exception e) {
+                // the document id below is all we have, then
+            }
+            byte id[] = createDocumentId();
+            for (int k = 0; k < id.length && k < 32; ++k)
+                seed[k] ^= id[k];
+            randomCipher = new AESCipher(seed, 0, 32);
+        }
+        byte counter[] = new byte[16];
+        byte block[] = new byte[16];
+        for (int k = 0; k < len; k += 16) {
+            long c = randomCounter++;
+            for (int j = 0; j < 8; ++j)
+                counter[j] = (byte)(c >>> (8 * j));
+            randomCipher.encryptBlock(counter, 0, block, 0);
+            System.arraycopy(block, 0, b, off + k, Math.min(16, len - k));
+        }
+    }
+
     public void prepareKey() {
-        prepareRC4Key(key, 0, keySize);
+        if (aes) // ssteward: nothing to prepare; see getKeyCipher()
+            return;
+        // ssteward: restore the state scheduled for this key, if we have it
+        if (keyStateValid) {
+            System.arraycopy(keyState, 0, state, 0, 256);
+            x = 0;
+            y = 0;
+            return;
+        }
+        scheduleRC4Key(key, 0, keySize);
+        System.arraycopy(state, 0, keyState, 0, 256);
+        keyStateValid = true;
     }
 
     public void setHashKey(int number, int generation) {
+        if (number == keyNumber && generation == keyGeneration) // ssteward
+            return;
+        keyNumber = number;
+        keyGeneration = generation;
+        keyStateValid = false;
+        if (revision >= 5) { // ssteward: one key for every object
+            key = mkey;
+            keySize = mkey.length;
+            return;
+        }
+        keyCipher = null;
         md5.reset();	//added by ujihara
         extra[0] = (byte)number;
         extra[1] = (byte)(number >> 8);
@@ -276,12 +608,87 @@ public class PdfEncryption {
         extra[3] = (byte)generation;
         extra[4] = (byte)(generation >> 8);
         md5.update(mkey);
-        key = md5.digest(extra);
+        md5.update(extra);
+        if (aes)
+            md5.update(salt);
+        key = md5.digest();
         keySize = mkey.length + 5;
         if (keySize > 16)
             keySize = 16;
     }
 
+    /** ssteward: the AES cipher for the current object key */
+    AESCipher getKeyCipher() {
+        if (keyCipher == null)
+            keyCipher = new AESCipher(key, 0, keySize);
+        return keyCipher;
+    }
+
+    /** ssteward: the length of <CODE>length</CODE> bytes once encrypted;
+     * AES adds the IV and pads to a whole block
+     */
+    public int calculateStreamSize(int length) {
+        if (aes)
+            return (length & 0x7ffffff0) + 32;
+        return length;
+    }
+
+    public byte[] encryptByteArray(byte b[]) {
+        return encryptByteArray(b, 0, b.length);
+    }
+
+    /** ssteward: encrypts <CODE>len</CODE> bytes with the current object
+     * key into a new array; with AES, it starts with a random IV
+     */
+    public byte[] encryptByteArray(byte b[], int off, int len) {
+        byte out[];
+        if (!aes) {
+            out = new byte[len];
+            System.arraycopy(b, off, out, 0, len);
+            prepareKey();
+            encryptRC4(out);
+            return out;
+        }
+        out = new byte[calculateStreamSize(len)];
+        randomBytes(out, 0, 16);
+        System.arraycopy(b, off, out, 16, len);
+        int pad = out.length - 16 - len;
+        for (int k = out.length - pad; k < out.length; ++k)
+            out[k] = (byte)pad;
+        getKeyCipher().encryptCBC(out, 0, out, 16, out.length - 16);
+        return out;
+    }
+
+    public byte[] decryptByteArray(byte b[]) {
+        return decryptByteArray(b, 0, b.length);
+    }
+
+    /** ssteward: decrypts <CODE>len</CODE> bytes with the current object
+     * key into a new array; AES data that is short or badly padded is
+     * decrypted as far as it goes, not rejected
+     */
+    public byte[] decryptByteArray(byte b[], int off, int len) {
+        byte out[];
+        if (!aes) {
+            out = new byte[len];
+            System.arraycopy(b, off, out, 0, len);
+            prepareKey();
+            encryptRC4(out);
+            return out;
+        }
+        int n = (len < 16) ? 0 : ((len - 16) & 0x7ffffff0);
+        if (n == 0)
+            return new byte[0];
+        out = new byte[n];
+        getKeyCipher().decryptCBC(b, off, b, off + 16, n, out, 0);
+        int pad = out[n - 1] & 0xff;
+        if (pad == 0 || pad > 16)
+            return out;
+        byte unpadded[] = new byte[n - pad];
+        System.arraycopy(out, 0, unpadded, 0, n - pad);
+        return unpadded;
+    }
+
     public static PdfObject createInfoId(byte id[]) {
         ByteBuffer buf = new ByteBuffer(90);
         buf.append('[').append('<');
@@ -301,7 +708,35 @@ public class PdfEncryption {
         dic.put(PdfName.O, new PdfLiteral(PdfContentByte.escapeString(ownerKey)));
         dic.put(PdfName.U, new PdfLiteral(PdfContentByte.escapeString(userKey)));
         dic.put(PdfName.P, new PdfNumber(permissions));
-        if (mkey.length > 5) {
+        if (aes) { // ssteward
+            PdfDictionary stdcf = new PdfDictionary();
+            stdcf.put(PdfName.AUTHEVENT, PdfName.DOCOPEN);
+            if (revision >= 5) {
+                dic.put(PdfName.OE, new PdfLiteral(PdfContentByte.escapeString(oeKey)));
+                dic.put(PdfName.UE, new PdfLiteral(PdfContentByte.escapeString(ueKey)));
+                dic.put(PdfName.PERMS, new PdfLiteral(PdfContentByte.escapeString(perms)));
+                dic.put(PdfName.V, new PdfNumber(5));
+                dic.put(PdfName.R, new PdfNumber(revision));
+                dic.put(PdfName.LENGTH, new PdfNumber(256));
+                stdcf.put(PdfName.CFM, PdfName.AESV3);
+                stdcf.put(PdfName.LENGTH, new PdfNumber(32));
+            }
+            else {
+                dic.put(PdfName.V, new PdfNumber(4));
+                dic.put(PdfName.R, new PdfNumber(4));
+                dic.put(PdfName.LENGTH, new PdfNumber(128));
+                stdcf.put(PdfName.CFM, PdfName.AESV2);
+                stdcf.put(PdfName.LENGTH, new PdfNumber(16));
+            }
+            if (!encryptMetadata)
+                dic.put(PdfName.ENCRYPTMETADATA, PdfBoolean.PDFFALSE);
+            PdfDictionary cf = new PdfDictionary();
+            cf.put(PdfName.STDCF, stdcf);
+            dic.put(PdfName.CF, cf);
+            dic.put(PdfName.STMF, encryptStreams ? PdfName.STDCF : PdfName.IDENTITY);
+            dic.put(PdfName.STRF, encryptStrings ? PdfName.STDCF : PdfName.IDENTITY);
+        }
+        else if (mkey.length > 5) {
             dic.put(PdfName.V, new PdfNumber(2));
             dic.put(PdfName.R, new PdfNumber(3));
             dic.put(PdfName.LENGTH, new PdfNumber(128));
@@ -313,38 +748,115 @@ public class PdfEncryption {
         return dic;
     }
 
+    /** ssteward: revision 5 and 6 are Adobe extensions to PDF 1.7, which
+     * the catalog declares in its /Extensions dictionary
+     */
+    public void addExtensions(PdfDictionary catalog) {
+        if (revision < 5)
+            return;
+        PdfDictionary adbe = new PdfDictionary();
+        adbe.put(PdfName.BASEVERSION, new PdfName("1.7"));
+        adbe.put(PdfName.EXTENSIONLEVEL, new PdfNumber(revision == 6 ? 8 : 3));
+        PdfObject obj = PdfReader.getPdfObject(catalog.get(PdfName.EXTENSIONS));
+        PdfDictionary extensions;
+        if (obj != null && obj.isDictionary())
+            extensions = (PdfDictionary)obj;
+        else {
+            extensions = new PdfDictionary();
+            catalog.put(PdfName.EXTENSIONS, extensions);
+        }
+        extensions.put(PdfName.ADBE, adbe);
+    }
+
     public void prepareRC4Key(byte key[]) {
         prepareRC4Key(key, 0, key.length);
     }
 
     public void prepareRC4Key(byte key[], int off, int len) {
+        // ssteward: callers that schedule their own keys invalidate ours
+        keyNumber = -1;
+        keyStateValid = false;
+        scheduleRC4Key(key, off, len);
+    }
+
+    private void scheduleRC4Key(byte key[], int off, int len) {
+        int state[] = this.state;
         int index1 = 0;
         int index2 = 0;
         for (int k = 0; k < 256; ++k)
-            state[k] = (byte)k;
+            state[k] = k;
         x = 0;
         y = 0;
-        byte tmp;
+        int tmp;
         for (int k = 0; k < 256; ++k) {
-            index2 = (key[index1 + off] + state[k] + index2) & 255;
             tmp = state[k];
+            index2 = (key[index1 + off] + tmp + index2) & 255;
             state[k] = state[index2];
             state[index2] = tmp;
-            index1 = (index1 + 1) % len;
+            if (++index1 == len)
+                index1 = 0;
         }
     }
 
+    // ssteward: the RC4 state and counters live in locals for the loop
     public void encryptRC4(byte dataIn[], int off, int len, byte dataOut[]) {
+        int state[] = this.state;
+        int x = this.x;
+        int y = this.y;
         int length = len + off;
-        byte tmp;
+        int sx, sy;
         for (int k = off; k < length; ++k) {
             x = (x + 1) & 255;
-            y = (state[x] + y) & 255;
-            tmp = state[x];
-            state[x] = state[y];
-            state[y] = tmp;
-            dataOut[k] = (byte)(dataIn[k] ^ state[(state[x] + state[y]) & 255]);
+            sx = state[x];
+            y = (sx + y) & 255;
+            sy = state[y];
+            state[x] = sy;
+            state[y] = sx;
+            dataOut[k] = (byte)(dataIn[k] ^ state[(sx + sy) & 255]);
+        }
+        this.x = x;
+        this.y = y;
+    }
+
+    /** ssteward: decrypts <CODE>data</CODE> with <CODE>decrypt</CODE> and
+     * encrypts it again with <CODE>crypto</CODE> in a single pass; both
+     * must have their keys prepared.  Either may be <CODE>null</CODE>.
+     */
+    public static void transcryptRC4(PdfEncryption decrypt, PdfEncryption crypto, byte data[], int off, int len) {
+        if (decrypt == null || crypto == null) {
+            if (decrypt != null)
+                decrypt.encryptRC4(data, off, len, data);
+            else if (crypto != null)
+                crypto.encryptRC4(data, off, len, data);
+            return;
+        }
+        int ds[] = decrypt.state;
+        int dx = decrypt.x;
+        int dy = decrypt.y;
+        int cs[] = crypto.state;
+        int cx = crypto.x;
+        int cy = crypto.y;
+        int length = len + off;
+        int sx, sy, tx, ty;
+        for (int k = off; k < length; ++k) {
+            dx = (dx + 1) & 255;
+            sx = ds[dx];
+            dy = (sx + dy) & 255;
+            sy = ds[dy];
+            ds[dx] = sy;
+            ds[dy] = sx;
+            cx = (cx + 1) & 255;
+            tx = cs[cx];
+            cy = (tx + cy) & 255;
+            ty = cs[cy];
+            cs[cx] = ty;
+            cs[cy] = tx;
+            data[k] = (byte)(data[k] ^ ds[(sx + sy) & 255] ^ cs[(tx + ty) & 255]);
         }
+        decrypt.x = dx;
+        decrypt.y = dy;
+        crypto.x = cx;
+        crypto.y = cy;
     }
 
     public void encryptRC4(byte data[], int off, int len) {
@@ -58,17 +58,71 @@ public class PdfEncryptionStream extends FilterOutputStream {
     
     protected PdfEncryption enc;
     private byte buf[] = new byte[1];
+    // ssteward: with AES, the data goes out as the IV and then whole CBC
+    // blocks, encrypted a buffer at a time; finish() pads the last one
+    private AESCipher cipher;
+    private byte iv[];
+    private byte blocks[];
+    private int blocksLength;
     
     public PdfEncryptionStream(OutputStream out, PdfEncryption enc) {
         super(out);
         this.enc = enc;
+        if (enc.isAes())
+            cipher = enc.getKeyCipher();
     }
     
     public void write(byte[] b, int off, int len) throws IOException {
         if ((off | len | (b.length - (len + off)) | (off + len)) < 0)
             throw new IndexOutOfBoundsException();
-        enc.encryptRC4(b, off, len);
-        out.write(b, off, len);
+        if (cipher == null) {
+            enc.encryptRC4(b, off, len);
+            out.write(b, off, len);
+            return;
+        }
+        if (iv == null)
+            writeIV();
+        while (len > 0) {
+            int n = Math.min(len, blocks.length - blocksLength);
+            System.arraycopy(b, off, blocks, blocksLength, n);
+            blocksLength += n;
+            off += n;
+            len -= n;
+            if (blocksLength == blocks.length)
+                writeBlocks();
+        }
+    }
+    
+    private void writeIV() throws IOException {
+        iv = new byte[16];
+        PdfEncryption.randomBytes(iv, 0, 16);
+        out.write(iv);
+        blocks = new byte[0x10000];
+    }
+    
+    private void writeBlocks() throws IOException {
+        int n = blocksLength & 0x7ffffff0;
+        if (n == 0)
+            return;
+        cipher.encryptCBC(iv, 0, blocks, 0, n);
+        System.arraycopy(blocks, n - 16, iv, 0, 16);
+        out.write(blocks, 0, n);
+        blocksLength -= n;
+        System.arraycopy(blocks, n, blocks, 0, blocksLength);
+    }
+    
+    /** ssteward: pads and writes the last AES block; call it once all
+     * the data is written.  Nothing to do for RC4.
+     */
+    public void finish() throws IOException {
+        if (cipher == null)
+            return;
+        if (iv == null)
+            writeIV();
+        int pad = 16 - (blocksLength & 15);
+        for (int k = 0; k < pad; ++k)
+            blocks[blocksLength++] = (byte)pad;
+        writeBlocks();
     }
     
     public void close() throws IOException {
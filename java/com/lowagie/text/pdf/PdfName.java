@@ -41,6 +41,10 @@
 
 package com.lowagie.text.pdf;
 
+import java.lang.reflect.Field;
+import java.lang.reflect.Modifier;
+import java.util.ArrayList;
+
 /**
  * <CODE>PdfName</CODE> is an object that can be used as a name in a PDF-file.
  * <P>
@@ -75,6 +79,8 @@ public class PdfName extends PdfObject implements Comparable{
     /** A name */
     public static final PdfName ACTION = new PdfName("Action");
     /** A name */
+    public static final PdfName ADBE = new PdfName("ADBE");
+    /** A name */
     public static final PdfName ADBE_PKCS7_DETACHED = new PdfName("adbe.pkcs7.detached");
     /** A name */
     public static final PdfName ADBE_PKCS7_SHA1 = new PdfName("adbe.pkcs7.sha1");
@@ -85,6 +91,10 @@ public class PdfName extends PdfObject implements Comparable{
     /** A name */
     public static final PdfName ADOBE_PPKMS = new PdfName("Adobe.PPKMS");
     /** A name */
+    public static final PdfName AESV2 = new PdfName("AESV2");
+    /** A name */
+    public static final PdfName AESV3 = new PdfName("AESV3");
+    /** A name */
     public static final PdfName AIS = new PdfName("AIS");
     /** A name */
     public static final PdfName ALLPAGES = new PdfName("AllPages");
@@ -109,6 +119,8 @@ public class PdfName extends PdfObject implements Comparable{
     /** A name */
     public static final PdfName ASCIIHEXDECODE = new PdfName("ASCIIHexDecode");
     /** A name */
+    public static final PdfName AUTHEVENT = new PdfName("AuthEvent");
+    /** A name */
     public static final PdfName AUTHOR = new PdfName("Author");
     /** A name */
     public static final PdfName B = new PdfName("B");
@@ -117,6 +129,8 @@ public class PdfName extends PdfObject implements Comparable{
     /** A name */
     public static final PdfName BASEFONT = new PdfName("BaseFont");
     /** A name */
+    public static final PdfName BASEVERSION = new PdfName("BaseVersion");
+    /** A name */
     public static final PdfName BBOX = new PdfName("BBox");
     /** A name */
     public static final PdfName BC = new PdfName("BC");
@@ -179,6 +193,10 @@ public class PdfName extends PdfObject implements Comparable{
     /** A name */
     public static final PdfName CERT = new PdfName("Cert");
     /** A name */
+    public static final PdfName CF = new PdfName("CF");
+    /** A name */
+    public static final PdfName CFM = new PdfName("CFM");
+    /** A name */
     public static final PdfName CH = new PdfName("Ch");
     /** A name */
     public static final PdfName CHARPROCS = new PdfName("CharProcs");
@@ -279,6 +297,8 @@ public class PdfName extends PdfObject implements Comparable{
     // changed this member name to prevent confusion on gcj (ssteward)
     public static final PdfName m_DOMAIN = new PdfName("Domain");
     /** A name */
+    public static final PdfName DOCOPEN = new PdfName("DocOpen");
+    /** A name */
     public static final PdfName DP = new PdfName("DP");
     /** A name */
     public static final PdfName DR = new PdfName("DR");
@@ -309,12 +329,18 @@ public class PdfName extends PdfObject implements Comparable{
     /** A name */
     public static final PdfName ENCRYPT = new PdfName("Encrypt");
     /** A name */
+    public static final PdfName ENCRYPTMETADATA = new PdfName("EncryptMetadata");
+    /** A name */
     public static final PdfName ENDOFBLOCK = new PdfName("EndOfBlock");
     /** A name */
     public static final PdfName ENDOFLINE = new PdfName("EndOfLine");
     /** A name */
     public static final PdfName EXTEND = new PdfName("Extend");
     /** A name */
+    public static final PdfName EXTENSIONLEVEL = new PdfName("ExtensionLevel");
+    /** A name */
+    public static final PdfName EXTENSIONS = new PdfName("Extensions");
+    /** A name */
     public static final PdfName EXTGSTATE = new PdfName("ExtGState");
     /** A name */
     public static final PdfName EXPORT = new PdfName("Export");
@@ -619,6 +645,8 @@ public class PdfName extends PdfObject implements Comparable{
     /** A name */
     public static final PdfName Off = new PdfName("Off");
     /** A name */
+    public static final PdfName OE = new PdfName("OE");
+    /** A name */
     public static final PdfName OFF = new PdfName("OFF");
     /** A name */
     public static final PdfName ON = new PdfName("ON");
@@ -681,6 +709,8 @@ public class PdfName extends PdfObject implements Comparable{
     /** A name */
     public static final PdfName PERCEPTUAL = new PdfName("Perceptual");
     /** A name */
+    public static final PdfName PERMS = new PdfName("Perms");
+    /** A name */
     public static final PdfName PG = new PdfName("Pg");
     /** A name */
     public static final PdfName POPUP = new PdfName("Popup");
@@ -791,6 +821,12 @@ public class PdfName extends PdfObject implements Comparable{
     /** A name */
     public static final PdfName STATE = new PdfName("State");
     /** A name */
+    public static final PdfName STDCF = new PdfName("StdCF");
+    /** A name */
+    public static final PdfName STMF = new PdfName("StmF");
+    /** A name */
+    public static final PdfName STRF = new PdfName("StrF");
+    /** A name */
     public static final PdfName STRIKEOUT = new PdfName("StrikeOut");
     /** A name */
     public static final PdfName STRUCTPARENT = new PdfName("StructParent");
@@ -879,6 +915,8 @@ public class PdfName extends PdfObject implements Comparable{
     /** A name of an attribute. */
     public static final PdfName U = new PdfName("U");
     /** A name */
+    public static final PdfName UE = new PdfName("UE");
+    /** A name */
     public static final PdfName UF = new PdfName("UF");
     /** A name of an attribute. */
     public static final PdfName UHC = new PdfName("UHC");
@@ -905,6 +943,8 @@ public class PdfName extends PdfObject implements Comparable{
     /** A name */
     public static final PdfName V = new PdfName("V");
     /** A name */
+    public static final PdfName V2 = new PdfName("V2");
+    /** A name */
     public static final PdfName VERISIGN_PPKVS = new PdfName("VeriSign.PPKVS");
     /** A name */
     public static final PdfName VIEW = new PdfName("View");
@@ -961,6 +1001,82 @@ public class PdfName extends PdfObject implements Comparable{
     /** A name */
     public static final PdfName ZOOM = new PdfName("Zoom");
     
+    // ssteward: intern table for the names above, so the parser can hand out
+    // the shared constant instead of allocating a new name for every key it
+    // reads; open addressing over the unescaped name bytes, with the table
+    // kept at most a quarter full so probes stay short
+    private static PdfName internTable[];
+    private static int internMask;
+    
+    static {
+        ArrayList names = new ArrayList();
+        try {
+            Field fields[] = PdfName.class.getDeclaredFields();
+            for (int k = 0; k < fields.length; ++k) {
+                Field f = fields[k];
+                if (f.getType() != PdfName.class || !Modifier.isStatic(f.getModifiers()))
+                    continue;
+                PdfName name = (PdfName)f.get(null);
+                boolean plain = true;
+                for (int j = 1; j < name.bytes.length; ++j) {
+                    if (name.bytes[j] == '#') {
+                        plain = false;
+                        break;
+                    }
+                }
+                if (plain)
+                    names.add(name);
+            }
+        }
+        catch (Exception e) {
+            // no table; intern() finds nothing
+        }
+        int size = 16;
+        while (size < names.size() * 4)
+            size <<= 1;
+        internTable = new PdfName[size];
+        internMask = size - 1;
+        for (int k = 0; k < names.size(); ++k) {
+            PdfName name = (PdfName)names.get(k);
+            int h = internHash(name.bytes, 1, name.bytes.length - 1) & internMask;
+            while (internTable[h] != null && !internTable[h].equals(name))
+                h = (h + 1) & internMask;
+            if (internTable[h] == null)
+                internTable[h] = name;
+        }
+    }
+    
+    private static int internHash(byte b[], int off, int len) {
+        int h = len;
+        for (int k = 0; k < len; ++k)
+            h = 31 * h + (b[off + k] & 0xff);
+        return h ^ (h >>> 15);
+    }
+    
+    /**
+     * Looks up a standard name by its unescaped bytes (no leading '/'), as
+     * <CODE>PRTokeniser</CODE> reads them. ssteward
+     * @param b the name bytes
+     * @param len the number of bytes in <CODE>b</CODE> to use
+     * @return the shared <CODE>PdfName</CODE> constant, or <CODE>null</CODE>
+     */
+    static PdfName intern(byte b[], int len) {
+        int h = internHash(b, 0, len) & internMask;
+        PdfName name;
+        while ((name = internTable[h]) != null) {
+            byte nb[] = name.bytes;
+            if (nb.length == len + 1) {
+                int k = 0;
+                while (k < len && nb[k + 1] == b[k])
+                    ++k;
+                if (k == len)
+                    return name;
+            }
+            h = (h + 1) & internMask;
+        }
+        return null;
+    }
+    
     private int hash = 0;
     
     // constructors
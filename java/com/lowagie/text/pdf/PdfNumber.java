@@ -86,6 +86,20 @@ public class PdfNumber extends PdfObject {
         }
     }
     
+/**
+ * Constructs a <CODE>PdfNumber</CODE>-object from a number the parser has
+ * already converted; <CODE>content</CODE> is kept as the PDF representation.
+ * ssteward
+ *
+ * @param		content			the bytes the number was read from
+ * @param		value			their value
+ */
+    
+    PdfNumber(byte content[], double value) {
+        super(NUMBER, content);
+        this.value = value;
+    }
+    
 /**
  * Constructs a new INTEGER <CODE>PdfNumber</CODE>-object.
  *
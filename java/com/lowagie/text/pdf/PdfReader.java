@@ -60,6 +60,7 @@ import java.net.URL;
 import java.util.List;
 import java.util.ArrayList;
 import java.util.HashMap;
+import java.util.LinkedHashMap;
 import java.util.Map;
 import java.util.Set;
 import java.util.Iterator;
@@ -120,6 +121,9 @@ public class PdfReader {
     protected ArrayList strings = new ArrayList();
     protected boolean sharedStreams = true;
     protected boolean consolidateNamedDestinations = false;
+    private IntHashtable consolidatedPages; // ssteward: pages done by consolidateNamedDestinations(int)
+    private boolean consolidatedBookmarks = false; // ssteward
+    private HashMap consolidationNames; // ssteward
     protected int rValue;
     protected int pValue;
     private int objNum;
@@ -131,6 +135,29 @@ public class PdfReader {
     private int lastXrefPartial = -1;
     private boolean partial;
     
+    /** ssteward: in partial mode, released objects stay resident until this many
+     * more recently released objects push them out; see releaseXrefPartial() */
+    public static final int DEFAULT_PARTIAL_CACHE_SIZE = 2048;
+    private int partialCacheSize = DEFAULT_PARTIAL_CACHE_SIZE;
+    private LinkedHashMap partialCache; // Integer xref index -> itself, least recently released first
+    private IntHashtable partialPinned; // ssteward: xref indexes of edited objects, which are never let go
+    
+    /** ssteward: decoded object streams kept for partial mode, so reading
+     * several objects from one stream doesn't inflate it each time */
+    private static final int OBJSTM_CACHE_SIZE = 8;
+    private LinkedHashMap objStmCache; // Integer stream xref index -> Object[]{byte[], Integer first}
+    
+    /** ssteward: number of threads readDocObj() may use to inflate and parse
+     * object streams; 1 (the default) reads them serially */
+    public static int objStmThreads = 1;
+    /** ssteward: if true, opening an encrypted document with its user
+     * password fails like a bad password does, before the document is
+     * parsed; for callers that can do nothing without the owner password */
+    protected boolean ownerPasswordRequired = false;
+    /** ssteward: the reader that references and streams parsed here belong to;
+     * only the object stream workers parse on behalf of another reader */
+    private PdfReader owner = this;
+    
     /**
      * Holds value of property appendable.
      */
@@ -158,6 +185,20 @@ public class PdfReader {
         readPdf();
     }
     
+    /** ssteward: reads and parses a PDF document, unless it is encrypted
+     * and <CODE>ownerPassword</CODE> isn't its owner password
+     * @param filename the file name of the document
+     * @param ownerPassword the owner password, or <CODE>null</CODE>
+     * @param ownerPasswordRequired <CODE>true</CODE> to reject the user password, too
+     * @throws IOException on error; BadPasswordException for the wrong password
+     */
+    public PdfReader(String filename, byte ownerPassword[], boolean ownerPasswordRequired) throws IOException {
+        password = ownerPassword;
+        this.ownerPasswordRequired = ownerPasswordRequired;
+        tokens = new PRTokeniser(filename);
+        readPdf();
+    }
+    
     /** Reads and parses a PDF document.
      * @param pdfIn the byte array with the document
      * @throws IOException on error
@@ -235,6 +276,21 @@ public class PdfReader {
         readPdfPartial();
     }
     
+    /** ssteward: as above, in partial mode, unless the document is
+     * encrypted and <CODE>ownerPassword</CODE> isn't its owner password
+     * @param raf the document location
+     * @param ownerPassword the owner password, or <CODE>null</CODE>
+     * @param ownerPasswordRequired <CODE>true</CODE> to reject the user password, too
+     * @throws IOException on error; BadPasswordException for the wrong password
+     */
+    public PdfReader(RandomAccessFileOrArray raf, byte ownerPassword[], boolean ownerPasswordRequired) throws IOException {
+        password = ownerPassword;
+        this.ownerPasswordRequired = ownerPasswordRequired;
+        partial = true;
+        tokens = new PRTokeniser(raf);
+        readPdfPartial();
+    }
+    
     /** Creates an independent duplicate.
      * @param reader the <CODE>PdfReader</CODE> to duplicate
      */    
@@ -481,6 +537,9 @@ public class PdfReader {
             try {
                 readDocObj();
             }
+            catch (BadPasswordException ne) { // ssteward: a rebuilt xref won't help
+                throw ne;
+            }
             catch (IOException ne) {
                 if (rebuilt)
                     throw ne;
@@ -544,18 +603,54 @@ public class PdfReader {
      * @throws IOException
      */
     private void readDecryptedDocObj() throws IOException {
+        readEncryption(); // ssteward: usually done already
+        if (decrypt == null)
+            return;
+        for (int k = 0; k < strings.size(); ++k) {
+            PdfString str = (PdfString)strings.get(k);
+            str.decrypt(this);
+        }
+        PdfObject encDic = trailer.get(PdfName.ENCRYPT);
+        if (encDic.isIndirect())
+            xrefObj.set(((PRIndirectReference)encDic).getNumber(), null);
+    }
+    
+    /** ssteward: resolves <CODE>obj</CODE> even before readDocObj() has
+     * loaded the objects, by reading it on its own
+     */
+    private PdfObject readEarlyObject(PdfObject obj) throws IOException {
+        PdfObject direct = getPdfObject(obj);
+        if (direct != null || partial || obj == null || !obj.isIndirect())
+            return direct;
+        int k = ((PRIndirectReference)obj).getNumber();
+        if (k * 2 + 1 >= xref.length || xref[k * 2 + 1] > 0)
+            return null;
+        return readSingleObject(k);
+    }
+    
+    /**
+     * ssteward: reads the /Encrypt dictionary and checks the password with
+     * it.  readDocObj() calls this before it loads any object, so a wrong
+     * password fails fast instead of after a full parse.
+     * @throws IOException on error; BadPasswordException if the password
+     * is neither the owner's nor the user's
+     */
+    private void readEncryption() throws IOException {
         if (encrypted)
             return;
         PdfObject encDic = trailer.get(PdfName.ENCRYPT);
         if (encDic == null || encDic.toString().equals("null"))
             return;
+        PdfObject encObj = readEarlyObject(encDic);
+        if (encObj == null || !encObj.isDictionary())
+            throw new IOException("Missing encryption dictionary.");
         encrypted = true;
-        PdfDictionary enc = (PdfDictionary)getPdfObject(encDic);
+        PdfDictionary enc = (PdfDictionary)encObj;
         
         String s;
         PdfObject o;
         
-        PdfArray documentIDs = (PdfArray)getPdfObject(trailer.get(PdfName.ID));
+        PdfArray documentIDs = (PdfArray)readEarlyObject(trailer.get(PdfName.ID));
         byte documentID[] = null;
         if (documentIDs != null) {
             o = (PdfObject)documentIDs.getArrayList().get(0);
@@ -571,33 +666,93 @@ public class PdfReader {
         o = enc.get(PdfName.R);
         if (!o.isNumber()) throw new IOException("Illegal R value.");
         rValue = ((PdfNumber)o).intValue();
-        if (rValue != 2 && rValue != 3) throw new IOException("Unknown encryption type (" + rValue + ")");
+        if (rValue < 2 || rValue > 6) throw new IOException("Unknown encryption type (" + rValue + ")");
         
         o = enc.get(PdfName.P);
         if (!o.isNumber()) throw new IOException("Illegal P value.");
         pValue = ((PdfNumber)o).intValue();
         
+        // ssteward: revisions 4 to 6 name the crypt filters for streams and
+        // strings, /StmF and /StrF, each either /Identity or one in /CF with
+        // its method; revision 4 may use RC4 or AES-128, 5 and 6 AES-256.
+        // One PdfEncryption has one method, so both must use the same one
+        boolean aes = (rValue >= 5);
+        boolean encryptStreams = true;
+        boolean encryptStrings = true;
+        if (rValue >= 4) {
+            PdfName stmMethod = getCryptFilterMethod(enc, PdfName.STMF);
+            PdfName strMethod = getCryptFilterMethod(enc, PdfName.STRF);
+            if (stmMethod != null && strMethod != null && !stmMethod.equals(strMethod))
+                throw new IOException("Streams and strings use different crypt filter methods (" + stmMethod + " and " + strMethod + "); this is not supported.");
+            encryptStreams = (stmMethod != null);
+            encryptStrings = (strMethod != null);
+            PdfName method = (stmMethod != null) ? stmMethod : strMethod;
+            if (method != null) {
+                if (rValue == 4 && PdfName.AESV2.equals(method))
+                    aes = true;
+                else if (!(rValue == 4 ? PdfName.V2 : PdfName.AESV3).equals(method))
+                    throw new IOException("Crypt filter method " + method + " is not supported with revision " + rValue + ".");
+            }
+        }
+        o = getPdfObject(enc.get(PdfName.ENCRYPTMETADATA));
+        boolean encryptMetadata = (o == null || !o.isBoolean() || ((PdfBoolean)o).booleanValue());
+        
         decrypt = new PdfEncryption();
+        decrypt.setCryptoMode(rValue, aes, encryptMetadata);
+        decrypt.setCryptFilters(encryptStreams, encryptStrings);
         
+        if (rValue >= 5) {
+            byte oeValue[] = null;
+            byte ueValue[] = null;
+            o = enc.get(PdfName.OE);
+            if (o != null)
+                oeValue = com.lowagie.text.DocWriter.getISOBytes(o.toString());
+            o = enc.get(PdfName.UE);
+            if (o != null)
+                ueValue = com.lowagie.text.DocWriter.getISOBytes(o.toString());
+            if (decrypt.setupByOwnerPasswordAES256(documentID, password, uValue, oValue, ueValue, oeValue, pValue))
+                passwordIsOwner= true;
+            else if (ownerPasswordRequired || !decrypt.setupByUserPasswordAES256(documentID, password, uValue, oValue, ueValue, oeValue, pValue))
+                throw new BadPasswordException();
+        }
+        else {
 		// switched by ssteward
 		//check by owner password, first, to ensure greatest authorization
-		decrypt.setupByOwnerPassword(documentID, password, uValue, oValue, pValue, (rValue == 3));
-		if (equalsArray(uValue, decrypt.userKey, ((rValue == 3) ? 16 : 32))) {
+		decrypt.setupByOwnerPassword(documentID, password, uValue, oValue, pValue, (rValue >= 3));
+		if (equalsArray(uValue, decrypt.userKey, ((rValue >= 3) ? 16 : 32))) {
 			passwordIsOwner= true;
 		}
 		else {
+			if (ownerPasswordRequired) // ssteward
+				throw new BadPasswordException();
 			//check by user password
-			decrypt.setupByUserPassword(documentID, password, oValue, pValue, (rValue == 3));
-			if (!equalsArray(uValue, decrypt.userKey, ((rValue == 3) ? 16 : 32))) {
-                throw new IOException("Bad password");
+			decrypt.setupByUserPassword(documentID, password, oValue, pValue, (rValue >= 3));
+			if (!equalsArray(uValue, decrypt.userKey, ((rValue >= 3) ? 16 : 32))) {
+                throw new BadPasswordException();
             }
         }
-        for (int k = 0; k < strings.size(); ++k) {
-            PdfString str = (PdfString)strings.get(k);
-            str.decrypt(this);
         }
-        if (encDic.isIndirect())
-            xrefObj.set(((PRIndirectReference)encDic).getNumber(), null);
+    }
+    
+    /**
+     * ssteward: the method of the crypt filter that /StmF or /StrF names,
+     * or null for /Identity, the default, which leaves the data as it is
+     * @throws IOException if the filter is missing or its method unknown
+     */
+    private static PdfName getCryptFilterMethod(PdfDictionary enc, PdfName key) throws IOException {
+        PdfObject name = getPdfObject(enc.get(key));
+        if (name == null || PdfName.IDENTITY.equals(name))
+            return null;
+        PdfObject cf = getPdfObject(enc.get(PdfName.CF));
+        PdfObject filter = null;
+        if (name.isName() && cf != null && cf.isDictionary())
+            filter = getPdfObject(((PdfDictionary)cf).get((PdfName)name));
+        if (filter == null || !filter.isDictionary())
+            throw new IOException("Unknown crypt filter (" + name + ") for " + key + ".");
+        PdfObject cfm = getPdfObject(((PdfDictionary)filter).get(PdfName.CFM));
+        if (PdfName.V2.equals(cfm) || PdfName.AESV2.equals(cfm) || PdfName.AESV3.equals(cfm))
+            return (PdfName)cfm;
+        throw new IOException("Unknown crypt filter method (" + cfm + ") in " + name + ".");
     }
     
     /**
@@ -722,8 +877,15 @@ public class PdfReader {
             if (idx < 0 || idx >= xrefObj.size())
                 return null;
             PdfObject obj = (PdfObject)xrefObj.get(idx);
-            if (!partial || obj != null)
+            if (!partial)
+                return obj;
+            if (obj != null) {
+                // a released object is the caller's again until released again;
+                // an object held by somebody else stays put
+                if (partialCache != null && partialCache.remove(new Integer(idx)) != null)
+                    lastXrefPartial = idx;
                 return obj;
+            }
             if (idx * 2 >= xref.length)
                 return null;
             obj = readSingleObject(idx);
@@ -749,7 +911,7 @@ public class PdfReader {
      */
     public void releaseLastXrefPartial() {
         if (partial && lastXrefPartial != -1) {
-            xrefObj.set(lastXrefPartial, null);
+            releaseXrefPartial(lastXrefPartial);
             lastXrefPartial = -1;
         }
     }
@@ -765,17 +927,113 @@ public class PdfReader {
         PRIndirectReference ref = (PRIndirectReference)obj;
         PdfReader reader = ref.getReader();
         if (reader.partial && reader.lastXrefPartial != -1 && reader.lastXrefPartial == ref.getNumber()) {
-            reader.xrefObj.set(reader.lastXrefPartial, null);
+            reader.releaseXrefPartial(reader.lastXrefPartial);
         }
         reader.lastXrefPartial = -1;
     }
 
+    /**
+     * ssteward: let go of an object read in partial mode. The object stays in
+     * <CODE>xrefObj</CODE> until <CODE>partialCacheSize</CODE> objects released after
+     * it have pushed it out, so objects that are dereferenced over and over
+     * (fonts, page tree nodes, shared resources) aren't parsed over and over.
+     * Objects that were read but never released stay resident; somebody holds them.
+     * So do pinned objects and objects added in memory, since reading them
+     * again wouldn't give back what they hold now.
+     * @param idx the xref index of the object
+     */
+    private void releaseXrefPartial(int idx) {
+        if (idx * 2 >= xref.length || (partialPinned != null && partialPinned.containsKey(idx)))
+            return;
+        if (partialCacheSize <= 0) {
+            xrefObj.set(idx, null);
+            return;
+        }
+        if (partialCache == null)
+            partialCache = new LinkedHashMap();
+        Integer key = new Integer(idx);
+        partialCache.remove(key); // move to the back
+        partialCache.put(key, key);
+        if (partialCache.size() > partialCacheSize) {
+            Iterator it = partialCache.keySet().iterator();
+            int eldest = ((Integer)it.next()).intValue();
+            it.remove();
+            xrefObj.set(eldest, null);
+        }
+    }
+
+    /**
+     * ssteward: sets how many released objects a partial-mode reader keeps resident.
+     * Zero restores the old behavior of dropping objects as soon as they are released.
+     * @param size the number of objects
+     */
+    public void setPartialCacheSize(int size) {
+        partialCacheSize = size;
+        if (partialCache == null)
+            return;
+        Iterator it = partialCache.keySet().iterator();
+        while (partialCache.size() > Math.max(size, 0) && it.hasNext()) {
+            xrefObj.set(((Integer)it.next()).intValue(), null);
+            it.remove();
+        }
+    }
+    
+    /**
+     * @return the number of released objects a partial-mode reader keeps resident
+     */
+    public int getPartialCacheSize() {
+        return partialCacheSize;
+    }
+
+    /**
+     * @return <CODE>true</CODE> if the reader loads objects on demand
+     */
+    public boolean isPartial() {
+        return partial;
+    }
+
     private void setXrefPartialObject(int idx, PdfObject obj) {
         if (!partial || idx < 0)
             return;
+        pinXrefPartial(idx);
         xrefObj.set(idx, obj);
     }
     
+    /**
+     * ssteward: keeps the object at xref index <CODE>idx</CODE> resident in
+     * partial mode, because it was edited; releasing it won't let it go, so
+     * it's never read again from the file and the edits aren't lost.
+     * @param idx the xref index of the object
+     */
+    private void pinXrefPartial(int idx) {
+        if (!partial || idx < 0)
+            return;
+        if (partialPinned == null)
+            partialPinned = new IntHashtable();
+        partialPinned.put(idx, 1);
+        if (partialCache != null)
+            partialCache.remove(new Integer(idx));
+    }
+    
+    /**
+     * ssteward: call this after editing an object read from this reader in
+     * partial mode, so it stays resident with its edits.
+     * @param ref an indirect reference to the object; anything else is ignored
+     */
+    public void pinPdfObject(PdfObject ref) {
+        if (ref instanceof PRIndirectReference && ((PRIndirectReference)ref).getReader() == this)
+            pinXrefPartial(((PRIndirectReference)ref).getNumber());
+    }
+    
+    /**
+     * ssteward: as <CODE>pinPdfObject()</CODE>, for the page dictionary of
+     * page <CODE>pageNum</CODE>
+     * @param pageNum the page number, starting at 1
+     */
+    public void pinPage(int pageNum) {
+        pinPdfObject(getPageOrigRef(pageNum));
+    }
+    
     /**
      * @param obj
      * @return an indirect reference
@@ -849,8 +1107,17 @@ public class PdfReader {
         int pos = xref[k2];
         if (pos < 0)
             return null;
-        if (xref[k2 + 1] > 0)
+        if (xref[k2 + 1] > 0) {
+            // ssteward: the object stream may already be decoded
+            Object stm[] = (objStmCache == null) ? null :
+                (Object[])objStmCache.get(new Integer(xref[k2 + 1]));
+            if (stm != null) {
+                PdfObject obj = readOneObjStm((byte[])stm[0], ((Integer)stm[1]).intValue(), xref[k2]);
+                xrefObj.set(k, obj);
+                return obj;
+            }
             pos = objStmToOffset.get(xref[k2 + 1]);
+        }
         tokens.seek(pos);
         tokens.nextValidToken();
         if (tokens.getTokenType() != PRTokeniser.TK_NUMBER)
@@ -861,7 +1128,7 @@ public class PdfReader {
             tokens.throwError("Invalid generation number.");
         objGen = tokens.intValue();
         tokens.nextValidToken();
-        if (!tokens.getStringValue().equals("obj"))
+        if (!tokens.stringValueEquals("obj"))
             tokens.throwError("Token 'obj' expected.");
         PdfObject obj;
         try {
@@ -878,7 +1145,18 @@ public class PdfReader {
             obj = null;
         }
         if (xref[k2 + 1] > 0) {
-            obj = readOneObjStm((PRStream)obj, xref[k2]);
+            PRStream stream = (PRStream)obj;
+            int first = ((PdfNumber)getPdfObject(stream.get(PdfName.FIRST))).intValue();
+            byte b[] = getStreamBytes(stream, tokens.getFile());
+            if (objStmCache == null)
+                objStmCache = new LinkedHashMap();
+            objStmCache.put(new Integer(xref[k2 + 1]), new Object[]{b, new Integer(first)});
+            if (objStmCache.size() > OBJSTM_CACHE_SIZE) {
+                Iterator it = objStmCache.keySet().iterator();
+                it.next();
+                it.remove();
+            }
+            obj = readOneObjStm(b, first, xref[k2]);
         }
         xrefObj.set(k, obj);
         return obj;
@@ -886,8 +1164,15 @@ public class PdfReader {
     
     protected PdfObject readOneObjStm(PRStream stream, int idx) throws IOException {
         int first = ((PdfNumber)getPdfObject(stream.get(PdfName.FIRST))).intValue();
-        int n = ((PdfNumber)getPdfObject(stream.get(PdfName.N))).intValue();
         byte b[] = getStreamBytes(stream, tokens.getFile());
+        return readOneObjStm(b, first, idx);
+    }
+    
+    /**
+     * Reads object number <CODE>idx</CODE> (0-based position in the stream
+     * index, not the object number) from the decoded bytes of an object stream.
+     */
+    protected PdfObject readOneObjStm(byte b[], int first, int idx) throws IOException {
         PRTokeniser saveTokens = tokens;
         tokens = new PRTokeniser(b);
         try {
@@ -939,6 +1224,10 @@ public class PdfReader {
         ArrayList streams = new ArrayList();
         xrefObj = new ArrayList(xref.length / 2);
         xrefObj.addAll(Collections.nCopies(xref.length / 2, null));
+        // ssteward: check the password before loading every object
+        strings.clear();
+        readEncryption();
+        strings.clear();
         for (int k = 2; k < xref.length; k += 2) {
             int pos = xref[k];
             if (pos <= 0 || xref[k + 1] > 0)
@@ -953,7 +1242,7 @@ public class PdfReader {
                 tokens.throwError("Invalid generation number.");
             objGen = tokens.intValue();
             tokens.nextValidToken();
-            if (!tokens.getStringValue().equals("obj"))
+            if (!tokens.stringValueEquals("obj"))
                 tokens.throwError("Token 'obj' expected.");
             PdfObject obj;
             try {
@@ -974,12 +1263,16 @@ public class PdfReader {
         }
         readDecryptedDocObj();
         if (objStmMark != null) {
-            for (Iterator i = objStmMark.entrySet().iterator(); i.hasNext();) {
-                Map.Entry entry = (Map.Entry)i.next();
-                int n = ((Integer)entry.getKey()).intValue();
-                IntHashtable h = (IntHashtable)entry.getValue();
-                readObjStm((PRStream)xrefObj.get(n), h);
-                xrefObj.set(n, null);
+            if (objStmThreads > 1 && objStmMark.size() > 1 && objStmsSelfContained())
+                readObjStmsParallel();
+            else {
+                for (Iterator i = objStmMark.entrySet().iterator(); i.hasNext();) {
+                    Map.Entry entry = (Map.Entry)i.next();
+                    int n = ((Integer)entry.getKey()).intValue();
+                    IntHashtable h = (IntHashtable)entry.getValue();
+                    readObjStm((PRStream)xrefObj.get(n), h);
+                    xrefObj.set(n, null);
+                }
             }
             objStmMark = null;
         }
@@ -1037,11 +1330,22 @@ public class PdfReader {
         int first = ((PdfNumber)getPdfObject(stream.get(PdfName.FIRST))).intValue();
         int n = ((PdfNumber)getPdfObject(stream.get(PdfName.N))).intValue();
         byte b[] = getStreamBytes(stream, tokens.getFile());
+        int objNumber[] = new int[n];
+        PdfObject objs[] = new PdfObject[n];
+        int count = parseObjStm(b, first, n, map, objNumber, objs);
+        for (int k = 0; k < count; ++k)
+            xrefObj.set(objNumber[k], objs[k]);
+    }
+    
+    /** ssteward: parses the members of the decoded object stream <CODE>b</CODE>
+     * that <CODE>map</CODE> selects into <CODE>objNumber</CODE> and <CODE>objs</CODE>;
+     * returns how many were parsed */
+    private int parseObjStm(byte b[], int first, int n, IntHashtable map, int objNumber[], PdfObject objs[]) throws IOException {
         PRTokeniser saveTokens = tokens;
         tokens = new PRTokeniser(b);
         try {
             int address[] = new int[n];
-            int objNumber[] = new int[n];
+            int number[] = new int[n];
             boolean ok = true;
             for (int k = 0; k < n; ++k) {
                 ok = tokens.nextToken();
@@ -1051,7 +1355,7 @@ public class PdfReader {
                     ok = false;
                     break;
                 }
-                objNumber[k] = tokens.intValue();
+                number[k] = tokens.intValue();
                 ok = tokens.nextToken();
                 if (!ok)
                     break;
@@ -1063,19 +1367,148 @@ public class PdfReader {
             }
             if (!ok)
                 throw new IOException("Error reading ObjStm");
+            int count = 0;
             for (int k = 0; k < n; ++k) {
                 if (map.containsKey(k)) {
                     tokens.seek(address[k]);
-                    PdfObject obj = readPRObject();
-                    xrefObj.set(objNumber[k], obj);
+                    objNumber[count] = number[k];
+                    objs[count++] = readPRObject();
                 }
-            }            
+            }
+            return count;
         }
         finally {
             tokens = saveTokens;
         }
     }
     
+    /** ssteward: true if no object stream takes its /First, /N, filters or
+     * decode parameters from an indirect object, which might itself live in an
+     * object stream that hasn't been read yet when the streams are read at once */
+    private boolean objStmsSelfContained() {
+        for (Iterator i = objStmMark.keySet().iterator(); i.hasNext();) {
+            PdfObject obj = (PdfObject)xrefObj.get(((Integer)i.next()).intValue());
+            if (obj == null || !obj.isStream())
+                return false;
+            PdfDictionary dic = (PdfDictionary)obj;
+            if (isIndirectEntry(dic, PdfName.FIRST) || isIndirectEntry(dic, PdfName.N)
+                || isIndirectEntry(dic, PdfName.FILTER) || isIndirectEntry(dic, PdfName.DECODEPARMS)
+                || isIndirectEntry(dic, PdfName.DP))
+                return false;
+        }
+        return true;
+    }
+    
+    private static boolean isIndirectEntry(PdfDictionary dic, PdfName key) {
+        PdfObject obj = dic.get(key);
+        if (obj == null)
+            return false;
+        if (obj.isIndirect())
+            return true;
+        if (obj.isArray()) {
+            ArrayList list = ((PdfArray)obj).getArrayList();
+            for (int k = 0; k < list.size(); ++k) {
+                if (((PdfObject)list.get(k)).isIndirect())
+                    return true;
+            }
+        }
+        return false;
+    }
+    
+    /** ssteward: one object stream for readObjStmsParallel() */
+    private static class ObjStmTask {
+        int streamIdx;
+        IntHashtable map;
+        int objNumber[];
+        PdfObject objs[];
+        int count;
+        Throwable error;
+    }
+    
+    /** ssteward: inflates and parses the object streams on up to objStmThreads
+     * threads.  Each worker gets its own file handle, decryptor and tokeniser.
+     * The results are installed into xrefObj afterwards, in the same order the
+     * serial loop would install them, and the first failure in that order is
+     * thrown just as the serial loop would have thrown it. */
+    private void readObjStmsParallel() throws IOException {
+        final ObjStmTask tasks[] = new ObjStmTask[objStmMark.size()];
+        int t = 0;
+        for (Iterator i = objStmMark.entrySet().iterator(); i.hasNext(); ++t) {
+            Map.Entry entry = (Map.Entry)i.next();
+            tasks[t] = new ObjStmTask();
+            tasks[t].streamIdx = ((Integer)entry.getKey()).intValue();
+            tasks[t].map = (IntHashtable)entry.getValue();
+        }
+        final int next[] = {0};
+        Runnable work = new Runnable() {
+            public void run() {
+                RandomAccessFileOrArray file = getSafeFile();
+                PdfEncryption dec = (decrypt == null) ? null : new PdfEncryption(decrypt);
+                PdfReader parser = new PdfReader();
+                parser.owner = PdfReader.this;
+                parser.strings = null;
+                parser.objNum = objNum;
+                parser.objGen = objGen;
+                try {
+                    while (true) {
+                        ObjStmTask task;
+                        synchronized (next) {
+                            if (next[0] == tasks.length)
+                                break;
+                            task = tasks[next[0]++];
+                        }
+                        try {
+                            PRStream stream = (PRStream)xrefObj.get(task.streamIdx);
+                            int first = ((PdfNumber)getPdfObject(stream.get(PdfName.FIRST))).intValue();
+                            int n = ((PdfNumber)getPdfObject(stream.get(PdfName.N))).intValue();
+                            file.reOpen();
+                            byte b[] = getStreamBytes(stream, file, dec);
+                            task.objNumber = new int[n];
+                            task.objs = new PdfObject[n];
+                            task.count = parser.parseObjStm(b, first, n, task.map, task.objNumber, task.objs);
+                        }
+                        catch (Throwable e) {
+                            task.error = e;
+                        }
+                    }
+                }
+                finally {
+                    try{file.close();}catch(Exception e){}
+                }
+            }
+        };
+        int nThreads = Math.min(objStmThreads, tasks.length);
+        Thread workers[] = new Thread[nThreads - 1];
+        for (int k = 0; k < workers.length; ++k) {
+            workers[k] = new Thread(work);
+            workers[k].setDaemon(true);
+            workers[k].start();
+        }
+        work.run(); // this thread takes its share, too
+        for (int k = 0; k < workers.length; ++k) {
+            while (workers[k].isAlive()) {
+                try {
+                    workers[k].join();
+                }
+                catch (InterruptedException e) {
+                    // keep waiting; xrefObj mustn't change under a worker
+                }
+            }
+        }
+        for (t = 0; t < tasks.length; ++t) {
+            ObjStmTask task = tasks[t];
+            if (task.error instanceof IOException)
+                throw (IOException)task.error;
+            if (task.error instanceof RuntimeException)
+                throw (RuntimeException)task.error;
+            if (task.error instanceof Error)
+                throw (Error)task.error;
+            for (int k = 0; k < task.count; ++k)
+                xrefObj.set(task.objNumber[k], task.objs[k]);
+            xrefObj.set(task.streamIdx, null);
+        }
+    }
+    
     static PdfObject killIndirect(PdfObject obj) {
         if (obj == null || obj.isNull())
             return null;
@@ -1110,7 +1543,7 @@ public class PdfReader {
         newXrefType = false;
         tokens.seek(tokens.getStartxref());
         tokens.nextToken();
-        if (!tokens.getStringValue().equals("startxref"))
+        if (!tokens.stringValueEquals("startxref"))
             throw new IOException("startxref not found.");
         tokens.nextToken();
         if (tokens.getTokenType() != PRTokeniser.TK_NUMBER)
@@ -1140,7 +1573,7 @@ public class PdfReader {
     
     protected PdfDictionary readXrefSection() throws IOException {
         tokens.nextValidToken();
-        if (!tokens.getStringValue().equals("xref"))
+        if (!tokens.stringValueEquals("xref"))
             tokens.throwError("xref subsection not found");
         int start = 0;
         int end = 0;
@@ -1148,7 +1581,7 @@ public class PdfReader {
         int gen = 0;
         while (true) {
             tokens.nextValidToken();
-            if (tokens.getStringValue().equals("trailer"))
+            if (tokens.stringValueEquals("trailer"))
                 break;
             if (tokens.getTokenType() != PRTokeniser.TK_NUMBER)
                 tokens.throwError("Object number of the first object in this xref subsection not found");
@@ -1177,14 +1610,14 @@ public class PdfReader {
                 gen = tokens.intValue();
                 tokens.nextValidToken();
                 int p = k * 2;
-                if (tokens.getStringValue().equals("n")) {
+                if (tokens.stringValueEquals("n")) {
                     if (xref[p] == 0 && xref[p + 1] == 0) {
 //                        if (pos == 0)
 //                            tokens.throwError("File position 0 cross-reference entry in this xref subsection");
                         xref[p] = pos;
                     }
                 }
-                else if (tokens.getStringValue().equals("f")) {
+                else if (tokens.stringValueEquals("f")) {
                     if (xref[p] == 0 && xref[p + 1] == 0)
                         xref[p] = -1;
                 }
@@ -1221,7 +1654,7 @@ public class PdfReader {
         thisStream = tokens.intValue();
         if (!tokens.nextToken() || tokens.getTokenType() != PRTokeniser.TK_NUMBER)
             return false;
-        if (!tokens.nextToken() || !tokens.getStringValue().equals("obj"))
+        if (!tokens.nextToken() || !tokens.stringValueEquals("obj"))
             return false;
         PdfObject object = readPRObject();
         PRStream stm = null;
@@ -1391,7 +1824,7 @@ public class PdfReader {
                 break;
             if (tokens.getTokenType() != PRTokeniser.TK_NAME)
                 tokens.throwError("Dictionary key is not a name.");
-            PdfName name = new PdfName(tokens.getStringValue());
+            PdfName name = tokens.getNameValue();
             PdfObject obj = readPRObject();
             int type = obj.type();
             if (-type == PRTokeniser.TK_END_DIC)
@@ -1425,13 +1858,13 @@ public class PdfReader {
                 PdfDictionary dic = readDictionary();
                 int pos = tokens.getFilePointer();
                 // be careful in the trailer. May not be a "next" token.
-                if (tokens.nextToken() && tokens.getStringValue().equals("stream")) {
+                if (tokens.nextToken() && tokens.stringValueEquals("stream")) {
                     int ch = tokens.read();
                     if (ch != '\n')
                         ch = tokens.read();
                     if (ch != '\n')
                         tokens.backOnePosition(ch);
-                    PRStream stream = new PRStream(this, tokens.getFilePointer());
+                    PRStream stream = new PRStream(owner, tokens.getFilePointer());
                     stream.putAll(dic);
                     stream.setObjNum(objNum, objGen);
                     return stream;
@@ -1444,7 +1877,7 @@ public class PdfReader {
             case PRTokeniser.TK_START_ARRAY:
                 return readArray();
             case PRTokeniser.TK_NUMBER:
-                return new PdfNumber(tokens.getStringValue());
+                return tokens.getNumberValue();
             case PRTokeniser.TK_STRING:
                 PdfString str = new PdfString(tokens.getStringValue(), null).setHexWriting(tokens.isHexString());
                 str.setObjNum(objNum, objGen);
@@ -1452,10 +1885,10 @@ public class PdfReader {
                     strings.add(str);
                 return str;
             case PRTokeniser.TK_NAME:
-                return new PdfName(tokens.getStringValue());
+                return tokens.getNameValue();
             case PRTokeniser.TK_REF:
                 int num = tokens.getReference();
-                PRIndirectReference ref = new PRIndirectReference(this, num, tokens.getGeneration());
+                PRIndirectReference ref = new PRIndirectReference(owner, num, tokens.getGeneration());
                 if (visited != null && !visited[num]) {
                     visited[num] = true;
                     newHits.put(num, 1);
@@ -1909,23 +2342,37 @@ public class PdfReader {
      * @throws IOException on error
      * @return the stream content
      */    
-    public static byte[] getStreamBytes(PRStream stream, RandomAccessFileOrArray file) throws IOException {
-        PdfReader reader = stream.getReader();
-        PdfObject filter = getPdfObjectRelease(stream.get(PdfName.FILTER));
-        byte b[];
+    /** ssteward: the stream's data, decrypted with <CODE>decrypt</CODE>
+     * (if not <CODE>null</CODE>) but not decoded
+     */
+    static byte[] getStreamBytesRaw(PRStream stream, RandomAccessFileOrArray file, PdfEncryption decrypt) throws IOException {
         if (stream.getOffset() < 0)
-            b = stream.getBytes();
-        else {
-            b = new byte[stream.getLength()];
-            file.seek(stream.getOffset());
-            file.readFully(b);
-            PdfEncryption decrypt = reader.getDecrypt();
-            if (decrypt != null) {
-                decrypt.setHashKey(stream.getObjNum(), stream.getObjGen());
+            return stream.getBytes();
+        byte b[] = new byte[stream.getLength()];
+        file.seek(stream.getOffset());
+        file.readFully(b);
+        if (decrypt != null && decrypt.isStreamEncrypted() && (decrypt.isMetadataEncrypted() || !PdfName.METADATA.equals(getPdfObjectRelease(stream.get(PdfName.TYPE))))) {
+            decrypt.setHashKey(stream.getObjNum(), stream.getObjGen());
+            if (decrypt.isAes())
+                b = decrypt.decryptByteArray(b);
+            else {
                 decrypt.prepareKey();
                 decrypt.encryptRC4(b);
             }
         }
+        return b;
+    }
+    
+    public static byte[] getStreamBytes(PRStream stream, RandomAccessFileOrArray file) throws IOException {
+        return getStreamBytes(stream, file, stream.getReader().getDecrypt());
+    }
+    
+    /** ssteward: as above, but decrypting with <CODE>decrypt</CODE>, which
+     * needn't be the reader's own; PdfEncryption keeps per-object key state,
+     * so threads reading concurrently each need their own copy */
+    static byte[] getStreamBytes(PRStream stream, RandomAccessFileOrArray file, PdfEncryption decrypt) throws IOException {
+        PdfObject filter = getPdfObjectRelease(stream.get(PdfName.FILTER));
+        byte b[] = getStreamBytesRaw(stream, file, decrypt);
         ArrayList filters = new ArrayList();
         if (filter != null) {
             if (filter.isName())
@@ -2135,7 +2582,7 @@ public class PdfReader {
      * @return <CODE>true</CODE> if the PDF has a 128 bit key encryption
      */    
     public boolean is128Key() {
-        return rValue == 3;
+        return rValue >= 3;
     }
     
     /**
@@ -2459,37 +2906,79 @@ public class PdfReader {
         if (consolidateNamedDestinations)
             return;
         consolidateNamedDestinations = true;
-        HashMap names = getNamedDestination();
+        HashMap names = getConsolidationNames();
+        if (names.size() == 0)
+            return;
+        for (int k = 1; k <= pageRefs.size(); ++k)
+            consolidatePageDestinations(k, names);
+        consolidateNamedBookmarks();
+    }
+    
+    /**
+     * ssteward: replaces the local named links on page <CODE>pageNum</CODE>
+     * only, so a partial reader that copies a few pages of a large document
+     * needn't visit all of them
+     * @param pageNum the page number, starting at 1
+     */
+    public void consolidateNamedDestinations(int pageNum) {
+        if (consolidateNamedDestinations || pageNum < 1 || pageNum > pageRefs.size())
+            return;
+        if (consolidatedPages == null)
+            consolidatedPages = new IntHashtable();
+        if (consolidatedPages.containsKey(pageNum))
+            return;
+        consolidatedPages.put(pageNum, 1);
+        HashMap names = getConsolidationNames();
+        if (names.size() > 0)
+            consolidatePageDestinations(pageNum, names);
+    }
+    
+    /**
+     * ssteward: replaces the named destinations of the bookmarks, only
+     */
+    public void consolidateNamedBookmarks() {
+        if (consolidatedBookmarks)
+            return;
+        consolidatedBookmarks = true;
+        HashMap names = getConsolidationNames();
         if (names.size() == 0)
             return;
-        for (int k = 1; k <= pageRefs.size(); ++k) {
-            PdfDictionary page = pageRefs.getPageN(k);
-            PdfObject annotsRef;
-            PdfArray annots = (PdfArray)getPdfObject(annotsRef = page.get(PdfName.ANNOTS));
-            int annotIdx = lastXrefPartial;
-            releaseLastXrefPartial();
-            if (annots == null) {
-                pageRefs.releasePage(k);
-                continue;
-            }
-            ArrayList list = annots.getArrayList();
-            boolean commitAnnots = false;
-            for (int an = 0; an < list.size(); ++an) {
-                PdfObject objRef = (PdfObject)list.get(an);
-                if (replaceNamedDestination(objRef, names) && !objRef.isIndirect())
-                    commitAnnots = true;
-            }
-            if (commitAnnots)
-                setXrefPartialObject(annotIdx,  annots);
-            if (!commitAnnots || annotsRef.isIndirect())
-                pageRefs.releasePage(k);
-        }
         PdfDictionary outlines = (PdfDictionary)getPdfObjectRelease(catalog.get(PdfName.OUTLINES));
         if (outlines == null)
             return;
         iterateBookmarks(outlines.get(PdfName.FIRST), names);
     }
     
+    /** ssteward: the named destinations, read once for all of the above */
+    private HashMap getConsolidationNames() {
+        if (consolidationNames == null)
+            consolidationNames = getNamedDestination();
+        return consolidationNames;
+    }
+    
+    private void consolidatePageDestinations(int k, HashMap names) {
+        PdfDictionary page = pageRefs.getPageN(k);
+        PdfObject annotsRef;
+        PdfArray annots = (PdfArray)getPdfObject(annotsRef = page.get(PdfName.ANNOTS));
+        int annotIdx = lastXrefPartial;
+        releaseLastXrefPartial();
+        if (annots == null) {
+            pageRefs.releasePage(k);
+            return;
+        }
+        ArrayList list = annots.getArrayList();
+        boolean commitAnnots = false;
+        for (int an = 0; an < list.size(); ++an) {
+            PdfObject objRef = (PdfObject)list.get(an);
+            if (replaceNamedDestination(objRef, names) && !objRef.isIndirect())
+                commitAnnots = true;
+        }
+        if (commitAnnots)
+            setXrefPartialObject(annotIdx,  annots);
+        if (!commitAnnots || annotsRef.isIndirect())
+            pageRefs.releasePage(k);
+    }
+    
     protected static PdfDictionary duplicatePdfDictionary(PdfDictionary original, PdfDictionary copy, PdfReader newReader) {
         if (copy == null)
             copy = new PdfDictionary();
@@ -2591,6 +3080,44 @@ public class PdfReader {
         }
     }
     
+    /** ssteward: as <CODE>removeUnusedNode()</CODE>, but only marks what's
+     * reachable; nothing is changed */
+    private void markReachableNode(PdfObject obj, boolean hits[]) {
+        if (obj == null)
+            return;
+        switch (obj.type()) {
+            case PdfObject.DICTIONARY: 
+            case PdfObject.STREAM: {
+                PdfDictionary dic = (PdfDictionary)obj;
+                for (Iterator it = dic.getKeys().iterator(); it.hasNext();)
+                    markReachableNode(dic.get((PdfName)it.next()), hits);
+                break;
+            }
+            case PdfObject.ARRAY: {
+                ArrayList list = ((PdfArray)obj).getArrayList();
+                for (int k = 0; k < list.size(); ++k)
+                    markReachableNode((PdfObject)list.get(k), hits);
+                break;
+            }
+            case PdfObject.INDIRECT: {
+                int num = ((PRIndirectReference)obj).getNumber();
+                if (num < hits.length && !hits[num]) {
+                    hits[num] = true;
+                    markReachableNode(getPdfObjectRelease(obj), hits);
+                }
+            }
+        }
+    }
+    
+    /** ssteward: finds the objects that can be reached from the trailer.
+     * @return a flag for each xref index, <CODE>true</CODE> if it's reachable
+     */
+    public boolean[] getReachableObjects() {
+        boolean hits[] = new boolean[xrefObj.size()];
+        markReachableNode(trailer, hits);
+        return hits;
+    }
+    
     /** Removes all the unreachable objects.
      * @return the number of indirect objects removed
      */    
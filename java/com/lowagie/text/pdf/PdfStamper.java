@@ -312,6 +312,25 @@ public class PdfStamper {
         stamper.setEncryption(userPassword, ownerPassword, permissions, strength128Bits);
     }
 
+    /** ssteward: as above, but <CODE>encryptionType</CODE> is one of
+     *  <CODE>PdfWriter.STANDARD_ENCRYPTION_40</CODE>, <CODE>STANDARD_ENCRYPTION_128</CODE>,
+     *  <CODE>ENCRYPTION_AES_128</CODE> or <CODE>ENCRYPTION_AES_256</CODE>.
+     *  The header's PDF version is already written, so AES needs the stamper
+     *  made with version 1.6 or 1.7.
+     * @param userPassword the user password. Can be null or empty
+     * @param ownerPassword the owner password. Can be null or empty
+     * @param permissions the user permissions
+     * @param encryptionType the type of encryption
+     * @throws DocumentException if anything was already written to the output
+     */
+    public void setEncryption(byte userPassword[], byte ownerPassword[], int permissions, int encryptionType) throws DocumentException {
+        if (stamper.isAppend())
+            throw new DocumentException("Append mode does not support changing the encryption status.");
+        if (stamper.isContentWritten())
+            throw new DocumentException("Content was already written to the output.");
+        stamper.setEncryption(userPassword, ownerPassword, permissions, encryptionType);
+    }
+
     /**
      * Sets the encryption options for this document. The userPassword and the
      *  ownerPassword can be null or have zero length. In this case the ownerPassword
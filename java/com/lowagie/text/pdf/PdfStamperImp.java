@@ -49,6 +49,7 @@ package com.lowagie.text.pdf;
 
 import java.io.IOException;
 import java.io.OutputStream;
+import java.util.Arrays;
 import java.util.ArrayList;
 import java.util.HashMap;
 import java.util.HashSet;
@@ -87,6 +88,9 @@ class PdfStamperImp extends PdfWriter {
     protected IntHashtable marked;
     protected int initialXrefSize;
     protected PdfAction openAction;
+    // ssteward: appearance key -> first flattened reference
+    private HashMap flatAppearances = new HashMap();
+    private SHA2Digest appearanceDigest;
     
     /** Creates new PdfStamperImp.
      * @param reader the read PDF
@@ -112,10 +116,7 @@ class PdfStamperImp extends PdfWriter {
                 crypto = new PdfEncryption(reader.getDecrypt());
             HEADER = getISOBytes("\n");
             file.reOpen();
-            byte buf[] = new byte[8192];
-            int n;
-            while ((n = file.read(buf)) > 0)
-                this.os.write(buf, 0, n);
+            this.os.writeFrom(file);
             file.close();
             prevxref = reader.getLastXref();
             reader.setAppendable(true);
@@ -146,8 +147,19 @@ class PdfStamperImp extends PdfWriter {
             reader.setViewerPreferences(vp);
             markUsed(reader.getTrailer().get(PdfName.ROOT));
         }
-        if (flat)
-            flatFields();
+        if (flat) {
+            try {
+                flatFields();
+            }
+            finally {
+                try {
+                    file.close(); // ssteward: opened to compare appearances
+                }
+                catch (Exception e) {
+                    // empty on purpose
+                }
+            }
+        }
         if (flatFreeText)
         	flatFreeTextFields();
         addFieldResources();
@@ -165,6 +177,8 @@ class PdfStamperImp extends PdfWriter {
         if (openAction != null) {
             reader.getCatalog().put(PdfName.OPENACTION, openAction);
         }
+        if (crypto != null && !append)
+            crypto.addExtensions(reader.getCatalog()); // ssteward
         // if there is XMP data to add: add it
         if (xmpMetadata != null) {
         	PdfDictionary catalog = reader.getCatalog();        	
@@ -706,6 +720,8 @@ class PdfStamperImp extends PdfWriter {
             if (array != null)
                 acroFds = array.getArrayList();
         }
+        HashMap flatShared = new HashMap(); // ssteward: object number -> shared appearance
+        ArrayList duplicates = new ArrayList();
         for (Iterator i = fields.keySet().iterator(); i.hasNext();) {
             String name = (String)i.next();
             if (!partialFlattening.isEmpty() && !partialFlattening.contains(name))
@@ -745,6 +761,10 @@ class PdfStamperImp extends PdfWriter {
                         }
                     }
                     if (app != null) {
+                        // ssteward: one XObject per distinct appearance
+                        PdfIndirectReference shared = shareFlatAppearance(app.getIndirectReference(), flatShared, duplicates);
+                        if (shared != app.getIndirectReference())
+                            app = new PdfAppearance(shared);
                         Rectangle box = PdfReader.getNormalizedRectangle((PdfArray)PdfReader.getPdfObject(merged.get(PdfName.RECT)));
                         PdfContentByte cb = getOverContent(page);
                         cb.setLiteral("Q ");
@@ -829,6 +849,89 @@ class PdfStamperImp extends PdfWriter {
             }
             eliminateAcroformObjects();
         }
+        // ssteward: the flattened widgets drew a shared copy, instead of their
+        // duplicate appearances; drop the duplicates nothing else refers to,
+        // e.g., an /MK icon, another annotation, or a resource dictionary
+        if (!duplicates.isEmpty()) {
+            boolean reachable[] = reader.getReachableObjects();
+            for (int k = 0; k < duplicates.size(); ++k) {
+                int num = ((PdfIndirectReference)duplicates.get(k)).getNumber();
+                if (num < reachable.length && !reachable[num])
+                    PdfReader.killIndirect((PdfObject)duplicates.get(k));
+            }
+        }
+    }
+
+    /** ssteward: returns the reference of the first appearance flattened
+     * whose stream is byte-identical to the one <CODE>ref</CODE> points to,
+     * so identical widgets all draw a single XObject; the per-instance
+     * placement stays in the content stream.  <CODE>ref</CODE> itself comes
+     * back when it is the first of its kind, or isn't a stream read from
+     * the original file.  Duplicates found are added to <CODE>duplicates</CODE>;
+     * they're left alone here, since something else may refer to them, too.
+     */
+    private PdfIndirectReference shareFlatAppearance(PdfIndirectReference ref, HashMap shared, ArrayList duplicates) {
+        if (!(ref instanceof PRIndirectReference))
+            return ref;
+        Integer num = new Integer(ref.getNumber());
+        PdfIndirectReference first = (PdfIndirectReference)shared.get(num);
+        if (first != null)
+            return first;
+        PdfObject obj = PdfReader.getPdfObject(ref);
+        if (!(obj instanceof PRStream))
+            return ref;
+        PRStream stream = (PRStream)obj;
+        try {
+            byte b[] = getAppearanceBytes(stream);
+            String key = getAppearanceKey(stream, b);
+            first = (PdfIndirectReference)flatAppearances.get(key);
+            if (first == null) {
+                flatAppearances.put(key, ref);
+                first = ref;
+            }
+            else if (Arrays.equals(b, getAppearanceBytes((PRStream)PdfReader.getPdfObject(first))))
+                duplicates.add(ref);
+            else // the digests match, the bytes don't
+                first = ref;
+        }
+        catch (IOException e) {
+            throw new ExceptionConverter(e);
+        }
+        shared.put(num, first);
+        return first;
+    }
+
+    /** ssteward: the raw bytes of an appearance stream */
+    private byte[] getAppearanceBytes(PRStream stream) throws IOException {
+        if (stream.getOffset() < 0)
+            return stream.getBytes();
+        byte b[] = new byte[stream.getLength()];
+        if (!file.isOpen())
+            file.reOpen(); // closed again by close()
+        file.seek(stream.getOffset());
+        file.readFully(b);
+        return b;
+    }
+
+    /** ssteward: the stream dictionary (less /Length) and a SHA-256 digest
+     * of the raw stream bytes <CODE>b</CODE>; a match is confirmed byte for
+     * byte before it's shared.  Encrypted streams never match, since each
+     * is encrypted with its own object key
+     */
+    private String getAppearanceKey(PRStream stream, byte b[]) {
+        if (appearanceDigest == null)
+            appearanceDigest = new SHA2Digest(256);
+        appearanceDigest.update(b);
+        byte digest[] = appearanceDigest.digest();
+        PdfDictionary dic = new PdfDictionary();
+        dic.putAll(stream);
+        dic.remove(PdfName.LENGTH);
+        StringBuffer key = new StringBuffer();
+        AcroFields.appendKey(key, dic);
+        key.append('|').append(b.length).append(':');
+        for (int k = 0; k < digest.length; ++k)
+            key.append(Integer.toHexString((digest[k] & 0xff) | 0x100).substring(1));
+        return key.toString();
     }
 
     void eliminateAcroformObjects() {
@@ -247,11 +247,23 @@ public class PdfStream extends PdfDictionary {
     public void toPdf(PdfWriter writer, OutputStream os) throws IOException {
         if (inputStream != null && compressed)
             put(PdfName.FILTER, PdfName.FLATEDECODE);
-        superToPdf(writer, os);
-        os.write(STARTSTREAM);
         PdfEncryption crypto = null;
         if (writer != null)
             crypto = writer.getEncryption();
+        if (crypto != null && (!crypto.isStreamEncrypted()
+            || (!crypto.isMetadataEncrypted() && PdfName.METADATA.equals(get(PdfName.TYPE)))))
+            crypto = null; // ssteward
+        // ssteward: AES adds an IV and padding, so /Length grows; this
+        // doesn't touch an indirect /Length, which is counted as it's written
+        PdfObject length = get(PdfName.LENGTH);
+        if (crypto != null && crypto.isAes() && length != null && length.isNumber()) {
+            put(PdfName.LENGTH, new PdfNumber(crypto.calculateStreamSize(((PdfNumber)length).intValue())));
+            superToPdf(writer, os);
+            put(PdfName.LENGTH, length);
+        }
+        else
+            superToPdf(writer, os);
+        os.write(STARTSTREAM);
         if (crypto != null)
             crypto.prepareKey();
         if (inputStream != null) {
@@ -275,6 +287,8 @@ public class PdfStream extends PdfDictionary {
             }
             if (def != null)
                 def.finish();
+            if (encs != null)
+                encs.finish();
             inputStreamLength = osc.getCounter();
         }
         else {
@@ -288,12 +302,13 @@ public class PdfStream extends PdfDictionary {
                 byte b[];
                 if (streamBytes != null) {
                     b = streamBytes.toByteArray();
-                    crypto.encryptRC4(b);
-                }
-                else {
-                    b = new byte[bytes.length];
-                    crypto.encryptRC4(bytes, b);
+                    if (crypto.isAes())
+                        b = crypto.encryptByteArray(b);
+                    else
+                        crypto.encryptRC4(b);
                 }
+                else
+                    b = crypto.encryptByteArray(bytes);
                 os.write(b);
             }
         }
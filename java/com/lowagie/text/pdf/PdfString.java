@@ -142,11 +142,8 @@ public class PdfString extends PdfObject {
         PdfEncryption crypto = null;
         if (writer != null)
             crypto = writer.getEncryption();
-        if (crypto != null) {
-            b = (byte[])bytes.clone();
-            crypto.prepareKey();
-            crypto.encryptRC4(b);
-        }
+        if (crypto != null && crypto.isStringEncrypted()) // ssteward
+            b = crypto.encryptByteArray(bytes); // ssteward: RC4 or AES
         if (hexWriting) {
             ByteBuffer buf = new ByteBuffer();
             buf.append('<');
@@ -209,12 +206,11 @@ public class PdfString extends PdfObject {
     
     void decrypt(PdfReader reader) {
         PdfEncryption decrypt = reader.getDecrypt();
-        if (decrypt != null) {
+        if (decrypt != null && decrypt.isStringEncrypted()) { // ssteward
             originalValue = value;
             decrypt.setHashKey(objNum, objGen);
-            decrypt.prepareKey();
             bytes = PdfEncodings.convertToBytes(value, null);
-            decrypt.encryptRC4(bytes);
+            bytes = decrypt.decryptByteArray(bytes); // ssteward: RC4 or AES
             value = PdfEncodings.convertToString(bytes, null);
         }
     }
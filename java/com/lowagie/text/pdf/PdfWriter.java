@@ -52,9 +52,11 @@
 package com.lowagie.text.pdf;
 
 import java.awt.Color;
+import java.io.ByteArrayOutputStream;
 import java.io.IOException;
 import java.io.OutputStream;
 import java.util.ArrayList;
+import java.util.LinkedList;
 import java.util.HashMap;
 import java.util.Iterator;
 import java.util.TreeMap;
@@ -243,15 +245,20 @@ public class PdfWriter extends DocWriter {
         
         // methods
         
-        private static final int OBJSINSTREAM = 200;
+        static final int OBJSINSTREAM = 200;
         
         private ByteBuffer index;
         private ByteBuffer streamObjects;
         private int currentObjNum;
         private int numObj = 0;
         
+        // ssteward: for reporting what object streams saved
+        int objStmCount = 0;
+        int objStmObjects = 0;
+        int objStmSaved = 0; // estimate: objects written plainly, less the object streams
+        
         private PdfWriter.PdfBody.PdfCrossReference addToObjStm(PdfObject obj, int nObj) throws IOException {
-            if (numObj >= OBJSINSTREAM)
+            if (numObj >= writer.objectsPerStream)
                 flushObjStm();
             if (index == null) {
                 index = new ByteBuffer();
@@ -265,6 +272,9 @@ public class PdfWriter extends DocWriter {
             writer.crypto = null;
             obj.toPdf(writer, streamObjects);
             writer.crypto = enc;
+            // "\nN 0 obj\n", the object, "\nendobj\n" and a 20 byte xref entry
+            objStmSaved += streamObjects.size() - p + String.valueOf(nObj).length() + 36;
+            ++objStmObjects;
             streamObjects.append(' ');
             index.append(nObj).append(' ').append(p).append(' ');
             return new PdfWriter.PdfBody.PdfCrossReference(2, nObj, currentObjNum, idx);
@@ -280,7 +290,10 @@ public class PdfWriter extends DocWriter {
             stream.put(PdfName.TYPE, PdfName.OBJSTM);
             stream.put(PdfName.N, new PdfNumber(numObj));
             stream.put(PdfName.FIRST, new PdfNumber(first));
+            int start = position;
             add(stream, currentObjNum);
+            objStmSaved -= position - start + 20;
+            ++objStmCount;
             index = null;
             streamObjects = null;
             numObj = 0;
@@ -361,20 +374,116 @@ public class PdfWriter extends DocWriter {
                 }
                 return indirect;
             }
+            else if (object instanceof PRStream && deflater() != null
+                     && ((PRStream)object).isDeflatedOnOutput(writer)) {
+                // ssteward: deflate on the pool; write it when its turn comes
+                PRStream stream = (PRStream)object;
+                byte b[] = stream.getBytesToDeflate(writer);
+                queue(new Pending(refNumber, stream, deflater.submit(b), b.length));
+                return new PdfIndirectObject(refNumber, object, writer);
+            }
+            else if (pending != null && !pending.isEmpty()) {
+                // ssteward: serialize now, so later changes to the object
+                // don't show, but write it after the streams ahead of it
+                PdfIndirectObject indirect = new PdfIndirectObject(refNumber, object, writer);
+                ByteArrayOutputStream buf = new ByteArrayOutputStream();
+                indirect.writeTo(buf);
+                queue(new Pending(refNumber, buf.toByteArray()));
+                return indirect;
+            }
             else {
                 PdfIndirectObject indirect = new PdfIndirectObject(refNumber, object, writer);
-				writer.getOs().write('\n'); // ssteward: for pretty pdf
-                PdfCrossReference pxref = new PdfCrossReference(refNumber, position+ 1); // ssteward: +1 for newline
-                if (!xrefs.add(pxref)) {
-                    xrefs.remove(pxref);
-                    xrefs.add(pxref);
-                }
-                indirect.writeTo(writer.getOs());
-                position = writer.getOs().getCounter();
+                write(refNumber, indirect, null);
                 return indirect;
             }
         }
         
+        private void write(int refNumber, PdfIndirectObject indirect, byte serialized[]) throws IOException {
+            writer.getOs().write('\n'); // ssteward: for pretty pdf
+            PdfCrossReference pxref = new PdfCrossReference(refNumber, position+ 1); // ssteward: +1 for newline
+            if (!xrefs.add(pxref)) {
+                xrefs.remove(pxref);
+                xrefs.add(pxref);
+            }
+            if (serialized != null)
+                writer.getOs().write(serialized);
+            else
+                indirect.writeTo(writer.getOs());
+            position = writer.getOs().getCounter();
+        }
+        
+        // ssteward: streams the compress option deflates on other threads
+        // (see PdfWriter.deflateThreads), and the objects added after them.
+        // Everything is written in the order it was added, so the output
+        // matches what the single-threaded writer produces.
+        
+        private static class Pending {
+            int refNumber;
+            PRStream stream;        // to deflate, or
+            ParallelDeflater.Job job;
+            byte serialized[];      // already serialized
+            int size;
+            
+            Pending(int refNumber, PRStream stream, ParallelDeflater.Job job, int size) {
+                this.refNumber = refNumber;
+                this.stream = stream;
+                this.job = job;
+                this.size = size;
+            }
+            
+            Pending(int refNumber, byte serialized[]) {
+                this.refNumber = refNumber;
+                this.serialized = serialized;
+                this.size = serialized.length;
+            }
+        }
+        
+        private ParallelDeflater deflater;
+        private LinkedList pending;
+        private int pendingSize = 0;
+        
+        private ParallelDeflater deflater() {
+            if (deflater == null && deflateThreads > 1 && writer.compressStreams) {
+                deflater = new ParallelDeflater(deflateThreads);
+                pending = new LinkedList();
+            }
+            return deflater;
+        }
+        
+        private void queue(Pending p) throws IOException {
+            pending.addLast(p);
+            pendingSize += p.size;
+            // write what's ready, then whatever keeps us within budget
+            while (!pending.isEmpty()) {
+                Pending first = (Pending)pending.getFirst();
+                if (first.job != null && !first.job.isDone() && pendingSize <= deflateBudget)
+                    break;
+                writeFirstPending();
+            }
+        }
+        
+        private void writeFirstPending() throws IOException {
+            Pending p = (Pending)pending.removeFirst();
+            pendingSize -= p.size;
+            if (p.stream != null) {
+                p.stream.setDeflatedBytes(deflater.get(p.job));
+                write(p.refNumber, new PdfIndirectObject(p.refNumber, p.stream, writer), null);
+            }
+            else
+                write(p.refNumber, null, p.serialized);
+        }
+        
+        /** ssteward: writes everything still waiting on the deflater */
+        void flushPending() throws IOException {
+            if (deflater == null)
+                return;
+            while (!pending.isEmpty())
+                writeFirstPending();
+            deflater.close();
+            deflater = null;
+            pending = null;
+        }
+        
         /**
          * Adds a <CODE>PdfResources</CODE> object to the body.
          *
@@ -434,8 +543,10 @@ public class PdfWriter extends DocWriter {
         
         void writeCrossReferenceTable(OutputStream os, PdfIndirectReference root, PdfIndirectReference info, PdfIndirectReference encryption, PdfObject fileID, int prevxref) throws IOException {
             int refNumber = 0;
-            if (writer.isFullCompression()) {
+            if (writer.isFullCompression())
                 flushObjStm();
+            flushPending();
+            if (writer.isFullCompression()) {
                 refNumber = getIndirectReferenceNumber();
                 xrefs.add(new PdfCrossReference(refNumber, position));
             }
@@ -643,6 +754,14 @@ public class PdfWriter extends DocWriter {
     public static final boolean STRENGTH40BITS = false;
     /** Type of encryption */
     public static final boolean STRENGTH128BITS = true;
+    /** Type of encryption: RC4, 40 bit key (ssteward) */
+    public static final int STANDARD_ENCRYPTION_40 = 0;
+    /** Type of encryption: RC4, 128 bit key */
+    public static final int STANDARD_ENCRYPTION_128 = 1;
+    /** Type of encryption: AES, 128 bit key; needs PDF 1.6 */
+    public static final int ENCRYPTION_AES_128 = 2;
+    /** Type of encryption: AES, 256 bit key; needs PDF 1.7, extension level 8 */
+    public static final int ENCRYPTION_AES_256 = 3;
     /** action value */
     public static final PdfName DOCUMENT_CLOSE = PdfName.WC;
     /** action value */
@@ -673,6 +792,8 @@ public class PdfWriter extends DocWriter {
     public static final char VERSION_1_5 = '5';
     /** possible PDF version */
     public static final char VERSION_1_6 = '6';
+    /** possible PDF version */
+    public static final char VERSION_1_7 = '7';
     
     private static final int VPOINT = 7;
     /** this is the header of a PDF document */
@@ -811,6 +932,11 @@ public class PdfWriter extends DocWriter {
     public boolean filterStreams = false;   // apply decode filters to some streams upon output
     public boolean compressStreams = false; // add compression to some stream upon output
 
+    // ssteward: when compressStreams is set, deflate on this many threads,
+    // holding at most deflateBudget bytes of stream data waiting to be written
+    public static int deflateThreads = 1;
+    public static int deflateBudget = 64 * 1024 * 1024;
+
     /** XMP Metadata for the document. */
     protected byte[] xmpMetadata = null;
     /**
@@ -818,6 +944,9 @@ public class PdfWriter extends DocWriter {
      */
     protected boolean fullCompression = false;
     
+    /** ssteward: objects packed into each object stream under full compression */
+    protected int objectsPerStream = PdfBody.OBJSINSTREAM;
+    
     protected boolean tagged = false;
 
     protected PdfObject fileID = null; // ssteward: allow setting of fileID
@@ -1307,6 +1436,8 @@ public class PdfWriter extends DocWriter {
                 if (extraCatalog != null) {
                     catalog.mergeDifferent(extraCatalog);
                 }
+                if (crypto != null)
+                    crypto.addExtensions(catalog); // ssteward
                 PdfIndirectObject indirectCatalog = addToBody(catalog, false);
                 // add the info-object to the body
                 PdfIndirectObject infoObj = addToBody(info, false);
@@ -1874,6 +2005,30 @@ public class PdfWriter extends DocWriter {
         crypto.setupAllKeys(userPassword, ownerPassword, permissions, strength128Bits);
     }
     
+    /** ssteward: as above, but <CODE>encryptionType</CODE> may also choose
+     *  AES.  It is one of STANDARD_ENCRYPTION_40, STANDARD_ENCRYPTION_128,
+     *  ENCRYPTION_AES_128 or ENCRYPTION_AES_256.  AES raises the header's
+     *  PDF version to 1.6 or 1.7, if it is lower and not yet written.
+     * @param userPassword the user password. Can be null or empty
+     * @param ownerPassword the owner password. Can be null or empty
+     * @param permissions the user permissions
+     * @param encryptionType the type of encryption
+     * @throws DocumentException if the document is already open
+     */
+    public void setEncryption(byte userPassword[], byte ownerPassword[], int permissions, int encryptionType) throws DocumentException {
+        if (pdf.isOpen())
+            throw new DocumentException("Encryption can only be added before opening the document.");
+        crypto = new PdfEncryption();
+        crypto.setupAllKeys(userPassword, ownerPassword, permissions, encryptionType);
+        char version = 0;
+        if (encryptionType == ENCRYPTION_AES_128)
+            version = VERSION_1_6;
+        else if (encryptionType == ENCRYPTION_AES_256)
+            version = VERSION_1_7;
+        if (HEADER.length > VPOINT && HEADER[VPOINT] < version)
+            HEADER[VPOINT] = (byte)version;
+    }
+    
     /**
      * Sets the encryption options for this document. The userPassword and the
      *  ownerPassword can be null or have zero length. In this case the ownerPassword
@@ -2549,6 +2704,33 @@ public class PdfWriter extends DocWriter {
         setPdfVersion(VERSION_1_5);
     }
     
+    /** ssteward: sets how many objects go into each object stream under
+     * full compression.  More objects compress better, but a reader must
+     * inflate a whole stream to get at any object in it.
+     * @param n the number of objects, at least 1
+     */
+    public void setObjectsPerStream(int n) {
+        if (n < 1)
+            throw new IllegalArgumentException("An object stream must hold at least one object.");
+        this.objectsPerStream = n;
+    }
+    
+    /** ssteward: the number of object streams written so far */
+    public int getObjectStreamCount() {
+        return body.objStmCount;
+    }
+    
+    /** ssteward: the number of objects packed into object streams so far */
+    public int getObjectStreamObjects() {
+        return body.objStmObjects;
+    }
+    
+    /** ssteward: roughly how many bytes the object streams saved, compared
+     * with writing their objects plainly with a classic xref table */
+    public int getObjectStreamSavings() {
+        return body.objStmSaved;
+    }
+    
     /**
      * Gets the <B>Optional Content Properties Dictionary</B>. Each call fills the dictionary with the current layer
      * state. It's advisable to only call this method right before close and do any modifications
@@ -55,11 +55,12 @@ import java.io.DataInput;
 import java.io.FileInputStream;
 import java.io.IOException;
 import java.io.EOFException;
-import java.io.RandomAccessFile;
 import java.io.File;
 import java.io.InputStream;
 import java.io.ByteArrayOutputStream;
+import java.io.OutputStream;
 import java.net.URL;
+import java.nio.channels.FileChannel;
 /** An implementation of a RandomAccessFile for input only
  * that accepts a file or a byte array as data source.
  *
@@ -67,7 +68,12 @@ import java.net.URL;
  */
 public class RandomAccessFileOrArray implements DataInput {
     
-    RandomAccessFile rf;
+    /** When <CODE>true</CODE>, files are never memory mapped; reads are
+     * still served from a large window (see <CODE>MappedRandomAccessFile</CODE>).
+     */
+    public static boolean plainRandomAccess = false;
+    
+    MappedRandomAccessFile rf;
     String filename;
     byte arrayIn[];
     int arrayInPtr;
@@ -126,7 +132,7 @@ public class RandomAccessFileOrArray implements DataInput {
         	return;
         }
         this.filename = filename;
-        rf = new RandomAccessFile(filename, "r");
+        rf = new MappedRandomAccessFile(filename, !plainRandomAccess);
     }
 
     public RandomAccessFileOrArray(URL url) throws IOException {
@@ -201,7 +207,10 @@ public class RandomAccessFileOrArray implements DataInput {
             }
         }
         if (arrayIn == null) {
-            return rf.read(b, off, len) + n;
+            int count = rf.read(b, off, len);
+            if (count < 0)
+                return n > 0 ? n : -1;
+            return count + n;
         }
         else {
             if (arrayInPtr >= arrayIn.length)
@@ -269,7 +278,7 @@ public class RandomAccessFileOrArray implements DataInput {
     
     public void reOpen() throws IOException {
         if (filename != null && rf == null)
-            rf = new RandomAccessFile(filename, "r");
+            rf = new MappedRandomAccessFile(filename, !plainRandomAccess);
         seek(0);
     }
     
@@ -279,6 +288,54 @@ public class RandomAccessFileOrArray implements DataInput {
         }
     }
     
+    /** ssteward: block size for copyTo() */
+    static final int COPY_BLOCK = 0x40000;
+    
+    /** ssteward: copies <CODE>length</CODE> bytes, from the current position,
+     * to <CODE>os</CODE>.  Bytes held in memory are written straight from the
+     * array; file bytes go through one large buffer, read in blocks aligned
+     * to <CODE>COPY_BLOCK</CODE>.
+     * @param os the destination
+     * @param length the number of bytes to copy
+     * @throws IOException on error, or if the input ends first
+     */
+    public void copyTo(OutputStream os, int length) throws IOException {
+        if (length <= 0)
+            return;
+        if (isBack) {
+            isBack = false;
+            os.write(back);
+            --length;
+        }
+        if (arrayIn != null) {
+            if (length > arrayIn.length - arrayInPtr)
+                throw new EOFException();
+            os.write(arrayIn, arrayInPtr, length);
+            arrayInPtr += length;
+            return;
+        }
+        insureOpen();
+        byte buf[] = new byte[Math.min(length, COPY_BLOCK)];
+        // the first read only reaches the next block boundary
+        int n = COPY_BLOCK - (int)(rf.getFilePointer() % COPY_BLOCK);
+        while (length > 0) {
+            n = Math.min(Math.min(n, length), buf.length);
+            readFully(buf, 0, n);
+            os.write(buf, 0, n);
+            length -= n;
+            n = COPY_BLOCK;
+        }
+    }
+    
+    /** ssteward: the channel of the underlying file, or <CODE>null</CODE>
+     * when reading from memory; see OutputStreamCounter.writeFrom() */
+    public FileChannel getChannel() throws IOException {
+        if (arrayIn != null)
+            return null;
+        insureOpen();
+        return rf.getChannel();
+    }
+    
     public boolean isOpen() {
         return (filename == null || rf != null);
     }
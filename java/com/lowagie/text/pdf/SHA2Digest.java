@@ -0,0 +1,262 @@
+/*
+ * The contents of this file are subject to the Mozilla Public License Version 1.1
+ * (the "License"); you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the License.
+ *
+ * The Original Code is 'iText, a free JAVA-PDF library'.
+ *
+ * Alternatively, the contents of this file may be used under the terms of the
+ * LGPL license (the "GNU LIBRARY GENERAL PUBLIC LICENSE"), in which case the
+ * provisions of LGPL are applicable instead of those above.  If you wish to
+ * allow use of your version of this file only under the terms of the LGPL
+ * License and not to allow others to use your version of this file under
+ * the MPL, indicate your decision by deleting the provisions above and
+ * replace them with the notice and other provisions required by the LGPL.
+ * If you do not delete the provisions above, a recipient may use your version
+ * of this file under either the MPL or the GNU LIBRARY GENERAL PUBLIC LICENSE.
+ */
+
+package com.lowagie.text.pdf;
+
+/** The SHA-256, SHA-384 and SHA-512 message digests (FIPS 180-2), which
+ * the revision 5 and 6 standard security handlers hash passwords with.
+ * <P>
+ * They are here, rather than fetched from <CODE>MessageDigest</CODE>,
+ * because the security provider built for the older compilers only has MD5.
+ */
+final class SHA2Digest {
+
+    private static final int K256[] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+    private static final int H256[] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+
+    private static final long K512[] = {
+        0x428a2f98d728ae22L, 0x7137449123ef65cdL, 0xb5c0fbcfec4d3b2fL, 0xe9b5dba58189dbbcL,
+        0x3956c25bf348b538L, 0x59f111f1b605d019L, 0x923f82a4af194f9bL, 0xab1c5ed5da6d8118L,
+        0xd807aa98a3030242L, 0x12835b0145706fbeL, 0x243185be4ee4b28cL, 0x550c7dc3d5ffb4e2L,
+        0x72be5d74f27b896fL, 0x80deb1fe3b1696b1L, 0x9bdc06a725c71235L, 0xc19bf174cf692694L,
+        0xe49b69c19ef14ad2L, 0xefbe4786384f25e3L, 0x0fc19dc68b8cd5b5L, 0x240ca1cc77ac9c65L,
+        0x2de92c6f592b0275L, 0x4a7484aa6ea6e483L, 0x5cb0a9dcbd41fbd4L, 0x76f988da831153b5L,
+        0x983e5152ee66dfabL, 0xa831c66d2db43210L, 0xb00327c898fb213fL, 0xbf597fc7beef0ee4L,
+        0xc6e00bf33da88fc2L, 0xd5a79147930aa725L, 0x06ca6351e003826fL, 0x142929670a0e6e70L,
+        0x27b70a8546d22ffcL, 0x2e1b21385c26c926L, 0x4d2c6dfc5ac42aedL, 0x53380d139d95b3dfL,
+        0x650a73548baf63deL, 0x766a0abb3c77b2a8L, 0x81c2c92e47edaee6L, 0x92722c851482353bL,
+        0xa2bfe8a14cf10364L, 0xa81a664bbc423001L, 0xc24b8b70d0f89791L, 0xc76c51a30654be30L,
+        0xd192e819d6ef5218L, 0xd69906245565a910L, 0xf40e35855771202aL, 0x106aa07032bbd1b8L,
+        0x19a4c116b8d2d0c8L, 0x1e376c085141ab53L, 0x2748774cdf8eeb99L, 0x34b0bcb5e19b48a8L,
+        0x391c0cb3c5c95a63L, 0x4ed8aa4ae3418acbL, 0x5b9cca4f7763e373L, 0x682e6ff3d6b2b8a3L,
+        0x748f82ee5defb2fcL, 0x78a5636f43172f60L, 0x84c87814a1f0ab72L, 0x8cc702081a6439ecL,
+        0x90befffa23631e28L, 0xa4506cebde82bde9L, 0xbef9a3f7b2c67915L, 0xc67178f2e372532bL,
+        0xca273eceea26619cL, 0xd186b8c721c0c207L, 0xeada7dd6cde0eb1eL, 0xf57d4f7fee6ed178L,
+        0x06f067aa72176fbaL, 0x0a637dc5a2c898a6L, 0x113f9804bef90daeL, 0x1b710b35131c471bL,
+        0x28db77f523047d84L, 0x32caab7b40c72493L, 0x3c9ebe0a15c9bebcL, 0x431d67c49c100d4cL,
+        0x4cc5d4becb3e42b6L, 0x597f299cfc657e2aL, 0x5fcb6fab3ad6faecL, 0x6c44198c4a475817L};
+
+    private static final long H384[] = {
+        0xcbbb9d5dc1059ed8L, 0x629a292a367cd507L, 0x9159015a3070dd17L, 0x152fecd8f70e5939L,
+        0x67332667ffc00b31L, 0x8eb44a8768581511L, 0xdb0c2e0d64f98fa7L, 0x47b5481dbefa4fa4L};
+
+    private static final long H512[] = {
+        0x6a09e667f3bcc908L, 0xbb67ae8584caa73bL, 0x3c6ef372fe94f82bL, 0xa54ff53a5f1d36f1L,
+        0x510e527fade682d1L, 0x9b05688c2b3e6c1fL, 0x1f83d9abfb41bd6bL, 0x5be0cd19137e2179L};
+
+    private int bits;
+    private int blockSize;
+    private int h[];
+    private int w[];
+    private long hl[];
+    private long wl[];
+    private byte block[];
+    private int blockLength;
+    /** The number of bytes digested so far */
+    private long count;
+
+    /** Creates a digest.
+     * @param bits 256, 384 or 512
+     */
+    SHA2Digest(int bits) {
+        this.bits = bits;
+        if (bits == 256) {
+            blockSize = 64;
+            h = new int[8];
+            w = new int[64];
+        }
+        else if (bits == 384 || bits == 512) {
+            blockSize = 128;
+            hl = new long[8];
+            wl = new long[80];
+        }
+        else
+            throw new IllegalArgumentException("SHA-2 digest size must be 256, 384 or 512 bits.");
+        block = new byte[blockSize];
+        reset();
+    }
+
+    void reset() {
+        count = 0;
+        blockLength = 0;
+        if (bits == 256)
+            System.arraycopy(H256, 0, h, 0, 8);
+        else
+            System.arraycopy(bits == 384 ? H384 : H512, 0, hl, 0, 8);
+    }
+
+    void update(byte b[]) {
+        update(b, 0, b.length);
+    }
+
+    void update(byte b[], int off, int len) {
+        count += len;
+        if (blockLength > 0) {
+            int n = Math.min(len, blockSize - blockLength);
+            System.arraycopy(b, off, block, blockLength, n);
+            blockLength += n;
+            off += n;
+            len -= n;
+            if (blockLength < blockSize)
+                return;
+            processBlock(block, 0);
+            blockLength = 0;
+        }
+        for (; len >= blockSize; off += blockSize, len -= blockSize)
+            processBlock(b, off);
+        if (len > 0) {
+            System.arraycopy(b, off, block, 0, len);
+            blockLength = len;
+        }
+    }
+
+    /** Completes the digest and resets for the next one.
+     * @return the 32, 48 or 64 byte digest
+     */
+    byte[] digest() {
+        long bitCount = count << 3;
+        block[blockLength++] = (byte)0x80;
+        // the length takes the last 8 bytes of the block (16 for SHA-512,
+        // but the upper 8 are always zero here)
+        if (blockLength > blockSize - (blockSize / 8)) {
+            for (; blockLength < blockSize; ++blockLength)
+                block[blockLength] = 0;
+            processBlock(block, 0);
+            blockLength = 0;
+        }
+        for (; blockLength < blockSize - 8; ++blockLength)
+            block[blockLength] = 0;
+        for (int k = 0; k < 8; ++k)
+            block[blockSize - 1 - k] = (byte)(bitCount >>> (8 * k));
+        processBlock(block, 0);
+        byte out[] = new byte[bits / 8];
+        if (bits == 256) {
+            for (int k = 0; k < 8; ++k) {
+                for (int j = 0; j < 4; ++j)
+                    out[4 * k + j] = (byte)(h[k] >>> (24 - 8 * j));
+            }
+        }
+        else {
+            for (int k = 0; k < bits / 64; ++k) {
+                for (int j = 0; j < 8; ++j)
+                    out[8 * k + j] = (byte)(hl[k] >>> (56 - 8 * j));
+            }
+        }
+        reset();
+        return out;
+    }
+
+    private void processBlock(byte b[], int off) {
+        if (bits == 256)
+            processBlock256(b, off);
+        else
+            processBlock512(b, off);
+    }
+
+    private void processBlock256(byte b[], int off) {
+        int w[] = this.w;
+        for (int t = 0; t < 16; ++t, off += 4)
+            w[t] = (b[off] << 24) | ((b[off + 1] & 0xff) << 16) | ((b[off + 2] & 0xff) << 8) | (b[off + 3] & 0xff);
+        for (int t = 16; t < 64; ++t) {
+            int x = w[t - 15];
+            int y = w[t - 2];
+            int s0 = ((x >>> 7) | (x << 25)) ^ ((x >>> 18) | (x << 14)) ^ (x >>> 3);
+            int s1 = ((y >>> 17) | (y << 15)) ^ ((y >>> 19) | (y << 13)) ^ (y >>> 10);
+            w[t] = w[t - 16] + s0 + w[t - 7] + s1;
+        }
+        int h[] = this.h;
+        int a = h[0], b1 = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], hh = h[7];
+        for (int t = 0; t < 64; ++t) {
+            int s1 = ((e >>> 6) | (e << 26)) ^ ((e >>> 11) | (e << 21)) ^ ((e >>> 25) | (e << 7));
+            int t1 = hh + s1 + ((e & f) ^ (~e & g)) + K256[t] + w[t];
+            int s0 = ((a >>> 2) | (a << 30)) ^ ((a >>> 13) | (a << 19)) ^ ((a >>> 22) | (a << 10));
+            int t2 = s0 + ((a & b1) ^ (a & c) ^ (b1 & c));
+            hh = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b1;
+            b1 = a;
+            a = t1 + t2;
+        }
+        h[0] += a;
+        h[1] += b1;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+        h[5] += f;
+        h[6] += g;
+        h[7] += hh;
+    }
+
+    private void processBlock512(byte b[], int off) {
+        long w[] = this.wl;
+        for (int t = 0; t < 16; ++t) {
+            long v = 0;
+            for (int k = 0; k < 8; ++k)
+                v = (v << 8) | (b[off++] & 0xff);
+            w[t] = v;
+        }
+        for (int t = 16; t < 80; ++t) {
+            long x = w[t - 15];
+            long y = w[t - 2];
+            long s0 = ((x >>> 1) | (x << 63)) ^ ((x >>> 8) | (x << 56)) ^ (x >>> 7);
+            long s1 = ((y >>> 19) | (y << 45)) ^ ((y >>> 61) | (y << 3)) ^ (y >>> 6);
+            w[t] = w[t - 16] + s0 + w[t - 7] + s1;
+        }
+        long h[] = this.hl;
+        long a = h[0], b1 = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], hh = h[7];
+        for (int t = 0; t < 80; ++t) {
+            long s1 = ((e >>> 14) | (e << 50)) ^ ((e >>> 18) | (e << 46)) ^ ((e >>> 41) | (e << 23));
+            long t1 = hh + s1 + ((e & f) ^ (~e & g)) + K512[t] + w[t];
+            long s0 = ((a >>> 28) | (a << 36)) ^ ((a >>> 34) | (a << 30)) ^ ((a >>> 39) | (a << 25));
+            long t2 = s0 + ((a & b1) ^ (a & c) ^ (b1 & c));
+            hh = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b1;
+            b1 = a;
+            a = t1 + t2;
+        }
+        h[0] += a;
+        h[1] += b1;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+        h[5] += f;
+        h[6] += g;
+        h[7] += hh;
+    }
+}
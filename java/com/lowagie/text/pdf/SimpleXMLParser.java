@@ -115,6 +115,20 @@ public class SimpleXMLParser {
      * @throws IOException on error
      */    
     public static void parse(SimpleXMLDocHandler doc, InputStream in) throws IOException {
+        parse(doc, in, 0);
+    }
+
+    /**
+     * ssteward: as above, but long runs of text reach the handler in
+     * fragments of at most <CODE>textChunk</CODE> characters, so a huge
+     * element value never has to be held whole.  Only for handlers that
+     * cope with text split anywhere.
+     * @param doc the document handler
+     * @param in the document. The encoding is deduced from the stream. The stream is not closed
+     * @param textChunk the longest fragment of text, or 0 for no limit
+     * @throws IOException on error
+     */
+    public static void parse(SimpleXMLDocHandler doc, InputStream in, int textChunk) throws IOException {
         byte b4[] = new byte[4];
         int count = in.read(b4);
         if (count != 4)
@@ -146,7 +160,7 @@ public class SimpleXMLParser {
             if (decl != null)
                 encoding = decl;
         }
-        parse(doc, new InputStreamReader(in, getJavaEncoding(encoding)));
+        parse(doc, null, new InputStreamReader(in, getJavaEncoding(encoding)), false, textChunk);
     }
     
     private static String getDeclaredEncoding(String decl) {
@@ -199,11 +213,17 @@ public class SimpleXMLParser {
      * @throws IOException on error
      */
     public static void parse(SimpleXMLDocHandler doc, SimpleXMLDocHandlerComment comment, Reader r, boolean html) throws IOException {
-        BufferedReader reader;
-        if (r instanceof BufferedReader)
-            reader = (BufferedReader)r;
-        else
-            reader = new BufferedReader(r);
+        parse(doc, comment, r, html, 0);
+    }
+
+    // ssteward: textChunk as in parse(doc, in, textChunk)
+    private static void parse(SimpleXMLDocHandler doc, SimpleXMLDocHandlerComment comment, Reader r, boolean html, int textChunk) throws IOException {
+        Reader reader = r;
+        // ssteward: read a block at a time, rather than a (synchronized)
+        // char at a time
+        char buf[] = new char[0x2000];
+        int bufPos = 0;
+        int bufLen = 0;
         Stack st = new Stack();
         int depth = 0;
         int mode = PRE;
@@ -228,8 +248,13 @@ public class SimpleXMLParser {
                 c = pushBack;
                 pushBack = -1;
             }
-            else
-                c = reader.read();
+            else {
+                if (bufPos == bufLen) {
+                    bufLen = reader.read(buf, 0, buf.length);
+                    bufPos = 0;
+                }
+                c = (bufLen > 0) ? buf[bufPos++] : -1;
+            }
             if (c == -1)
                 break;
             
@@ -269,8 +294,13 @@ public class SimpleXMLParser {
                     st.push(new Integer(mode));
                     mode = ENTITY;
                     etag.setLength(0);
-                } else
+                } else {
                     sb.append((char)c);
+                    if (textChunk > 0 && sb.length() >= textChunk) { // ssteward
+                        doc.text(sb.toString());
+                        sb.setLength(0);
+                    }
+                }
                 
                 // we are processing a closing tag: e.g. </foo>
             } else if(mode == CLOSE_TAG) {
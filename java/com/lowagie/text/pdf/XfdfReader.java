@@ -50,9 +50,11 @@
 package com.lowagie.text.pdf;
 
 import java.io.ByteArrayInputStream;
+import java.io.ByteArrayOutputStream; // ssteward
 import java.io.IOException;
 import java.io.InputStream; // ssteward
 import java.io.FileInputStream;
+import java.util.ArrayList; // ssteward
 import java.util.HashMap;
 import java.util.Stack;
 
@@ -74,6 +76,19 @@ public class XfdfReader implements SimpleXMLDocHandler {
 	
 	// storage for the path to referenced PDF, if any
 	String	fileSpec;
+
+	// ssteward: one {fields, fieldsRichText} pair per <fields> element;
+	// a batch fill_form takes each as a record
+	private ArrayList records = new ArrayList();
+
+	// ssteward: when set, <value>s are base64, decoded as they are read
+	// into fieldsBytes; equal values share one byte array
+	private boolean base64Values = false;
+	HashMap fieldsBytes = new HashMap();
+	private HashMap distinctBytes;
+
+	// ssteward: longest run of text the parser hands over at once
+	static final int TEXT_CHUNK = 0x10000;
 	
    /** Reads an XFDF form.
      * @param filename the file name of the form
@@ -103,6 +118,80 @@ public class XfdfReader implements SimpleXMLDocHandler {
     public XfdfReader(byte xfdfIn[]) throws IOException {
         SimpleXMLParser.parse( this, new ByteArrayInputStream(xfdfIn));
    }
+
+	/** ssteward: reads an XFDF form as it streams in, never holding the
+	 * whole input.
+	 * @param in the form; it is not closed
+	 * @param base64Values <CODE>true</CODE> to decode each
+	 * <CODE>&lt;value&gt;</CODE> from base64 as it is read, for
+	 * <CODE>getFieldsBytes()</CODE>, instead of keeping its text
+	 * @throws IOException on error
+	 */
+	public XfdfReader(InputStream in, boolean base64Values) throws IOException {
+		this.base64Values = base64Values;
+		if (base64Values)
+			distinctBytes = new HashMap();
+		SimpleXMLParser.parse(this, in, TEXT_CHUNK);
+		distinctBytes = null;
+	}
+
+	/** ssteward: returns <CODE>true</CODE> if <CODE>in</CODE> looks like
+	 * XFDF, <CODE>false</CODE> if it looks like FDF, judging by its first
+	 * non-blank byte.  <CODE>in</CODE> must support <CODE>mark()</CODE>;
+	 * it is left where it was.
+	 * @param in the form data
+	 * @throws IOException on error
+	 */
+	public static boolean isXfdf(InputStream in) throws IOException {
+		in.mark(1024);
+		try {
+			for (int k = 0; k < 1024; ++k) {
+				int c = in.read();
+				switch (c) {
+					case -1:
+						return false;
+					case '<': // XML
+					case 0x00: case 0xfe: case 0xff: // UTF-16 or UTF-32
+						return true;
+					case 0xef: case 0xbb: case 0xbf: // UTF-8 byte order mark
+					case ' ': case '\t': case '\r': case '\n':
+						continue;
+					default: // FDF, perhaps after some junk; PdfReader looks for %FDF
+						return false;
+				}
+			}
+			return false;
+		}
+		finally {
+			in.reset();
+		}
+	}
+
+	// ssteward: used by getRecord()
+	private XfdfReader() {
+	}
+
+	/** ssteward: returns the number of <CODE>&lt;fields&gt;</CODE> elements
+	 * read; the reader itself holds the final one.
+	 */
+	public int getRecordCount() {
+		return records.size();
+	}
+
+	/** ssteward: returns a reader that holds only the fields of the
+	 * <CODE>k</CODE>th <CODE>&lt;fields&gt;</CODE> element.  The field maps
+	 * are shared, not copied.
+	 * @param k the 0-based record number
+	 */
+	public XfdfReader getRecord(int k) {
+		HashMap record[] = (HashMap[])records.get(k);
+		XfdfReader ret = new XfdfReader();
+		ret.foundRoot = true;
+		ret.fields = record[0];
+		ret.fieldsRichText = record[1];
+		ret.fileSpec = fileSpec;
+		return ret;
+	}
     
     /** Gets all the fields. The map is keyed by the fully qualified
      * field name and the value is a merged <CODE>PdfDictionary</CODE>
@@ -151,6 +240,14 @@ public class XfdfReader implements SimpleXMLDocHandler {
         return fileSpec;
     }
 
+	/** ssteward: returns the decoded values when the form was read with
+	 * <CODE>base64Values</CODE> set, keyed by fully qualified field name.
+	 * Fields with equal values map to the same <CODE>byte[]</CODE>.
+	 */
+	public HashMap getFieldsBytes() {
+		return fieldsBytes;
+	}
+
     /**
      * Called when a start tag is found.
      * @param tag the tag name
@@ -175,10 +272,12 @@ public class XfdfReader implements SimpleXMLDocHandler {
     	} else if ( tag.equals("field") ) {
     		String	fName = (String) h.get( "name" );
     		fieldNames.push( fName );
+    	} else if ( tag.equals("value") && base64Values ) { // ssteward
+    		fieldValues.push( new Base64Value() );
     	} else if ( tag.equals("value") ||
 					tag.equals("value-richtext") ) // ssteward
 			{
-				fieldValues.push( (String)"" );
+				fieldValues.push( new StringBuffer() ); // ssteward: was String
 			}
     }
 
@@ -196,19 +295,30 @@ public class XfdfReader implements SimpleXMLDocHandler {
 				}
 				if (fName.startsWith("."))
 					fName = fName.substring(1);
-				String	fVal = (String) fieldValues.pop();
+				Object	fVal = fieldValues.pop();
 
-				if (tag.equals("value")) { // ssteward
-					fields.put( fName, fVal );
+				if (fVal instanceof Base64Value) { // ssteward
+					byte b[] = ((Base64Value)fVal).toByteArray();
+					java.nio.ByteBuffer key = java.nio.ByteBuffer.wrap(b);
+					byte shared[] = (byte[])distinctBytes.get(key);
+					if (shared == null)
+						distinctBytes.put(key, shared = b);
+					fieldsBytes.put( fName, shared );
+				}
+				else if (tag.equals("value")) { // ssteward
+					fields.put( fName, fVal.toString() );
 				}
 				else { // rich text value
-					fieldsRichText.put( fName, fVal );
+					fieldsRichText.put( fName, fVal.toString() );
 				}
 			}
         else if (tag.equals("field") ) {
             if (!fieldNames.isEmpty())
                 fieldNames.pop();
         }
+		else if (tag.equals("fields") ) { // ssteward
+			records.add(new HashMap[] {fields, fieldsRichText});
+		}
     }
     
     /**
@@ -234,8 +344,60 @@ public class XfdfReader implements SimpleXMLDocHandler {
         if (fieldNames.isEmpty() || fieldValues.isEmpty())
             return;
         
-        String val = (String)fieldValues.pop();
-        val += str;
-        fieldValues.push(val);
+        // ssteward: append in place; was String concatenation
+        Object val = fieldValues.peek();
+        if (val instanceof Base64Value)
+            ((Base64Value)val).append(str);
+        else
+            ((StringBuffer)val).append(str);
     }
+
+	/** ssteward: base64 text decoded a fragment at a time; whitespace
+	 * and padding are skipped, as are any stray characters.
+	 */
+	private static class Base64Value {
+		private static final byte decodingTable[] = new byte[128];
+		static {
+			String chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+			for (int k = 0; k < decodingTable.length; ++k)
+				decodingTable[k] = -1;
+			for (int k = 0; k < chars.length(); ++k)
+				decodingTable[chars.charAt(k)] = (byte)k;
+		}
+
+		private ByteArrayOutputStream out = new ByteArrayOutputStream();
+		private int bits = 0; // the sextets of a partial quantum
+		private int count = 0; // how many
+
+		void append(String str) {
+			byte b[] = new byte[(str.length() / 4 + 1) * 3];
+			int n = 0;
+			for (int k = 0; k < str.length(); ++k) {
+				char c = str.charAt(k);
+				if (c >= 128 || decodingTable[c] < 0)
+					continue;
+				bits = (bits << 6) | decodingTable[c];
+				if (++count == 4) {
+					b[n++] = (byte)(bits >> 16);
+					b[n++] = (byte)(bits >> 8);
+					b[n++] = (byte)bits;
+					bits = 0;
+					count = 0;
+				}
+			}
+			out.write(b, 0, n);
+		}
+
+		byte[] toByteArray() {
+			if (count == 2)
+				out.write(bits >> 4);
+			else if (count == 3) {
+				out.write(bits >> 10);
+				out.write(bits >> 2);
+			}
+			bits = 0;
+			count = 0;
+			return out.toByteArray();
+		}
+	}
 }
@@ -70,10 +70,12 @@
 #include "com/lowagie/text/pdf/PdfEncryptor.h"
 #include "com/lowagie/text/pdf/PdfNameTree.h"
 #include "com/lowagie/text/pdf/FdfReader.h"
+#include "com/lowagie/text/pdf/XfdfReader.h"
 #include "com/lowagie/text/pdf/AcroFields.h"
 #include "com/lowagie/text/pdf/PdfIndirectReference.h"
 #include "com/lowagie/text/pdf/PdfIndirectObject.h"
 #include "com/lowagie/text/pdf/PdfFileSpecification.h"
+#include "com/lowagie/text/pdf/OutputSink.h"
 
 #include "com/lowagie/text/pdf/PdfAnnotation.h"
 #include "com/lowagie/text/pdf/PRStream.h"
@@ -0,0 +1,980 @@
+/* -*- Mode: C++; tab-width: 2; c-basic-offset: 2 -*- */
+/*
+	pdftk, the PDF Toolkit
+	Copyright (c) 2003, 2004, 2010 Sid Steward
+
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+	Visit: www.pdftk.com for pdftk information and articles
+	Permalink: http://www.pdflabs.com/tools/pdftk-the-pdf-toolkit/
+
+	Please email Sid Steward with questions or bug reports.
+	Include "pdftk" in the subject line to ensure successful delivery:
+	sid.steward at pdflabs dot com
+
+*/
+
+// Tell C++ compiler to use Java-style exceptions.
+#pragma GCC java_exceptions
+
+#include <gcj/cni.h>
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <map>
+#include <vector>
+#include <set>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <ctime>
+
+#ifdef USE_PTHREADS
+#include <pthread.h>
+#endif
+
+#include <java/lang/System.h>
+#include <java/lang/Throwable.h>
+#include <java/lang/Exception.h>
+#include <java/lang/String.h>
+#include <java/lang/Runtime.h>
+#include <java/lang/Integer.h>
+#include <java/io/IOException.h>
+#include <java/io/File.h>
+#include <java/io/FileOutputStream.h>
+#include <java/io/ByteArrayOutputStream.h>
+#include <java/util/HashMap.h>
+#include <java/util/zip/CRC32.h>
+
+#include "com/lowagie/text/Document.h"
+#include "com/lowagie/text/pdf/PdfName.h"
+#include "com/lowagie/text/pdf/PdfObject.h"
+#include "com/lowagie/text/pdf/PdfDictionary.h"
+#include "com/lowagie/text/pdf/PdfCopy.h"
+#include "com/lowagie/text/pdf/PdfImportedPage.h"
+#include "com/lowagie/text/pdf/PdfReader.h"
+#include "com/lowagie/text/pdf/PdfWriter.h"
+#include "com/lowagie/text/pdf/RandomAccessFileOrArray.h"
+#include "com/lowagie/text/pdf/OutputSink.h"
+#include "com/lowagie/text/pdf/XfdfReader.h" // for pdftk.h
+
+#include <gcj/array.h>
+
+using namespace std;
+
+namespace java {
+	using namespace java::lang;
+	using namespace java::io;
+	using namespace java::util;
+}
+
+namespace itext {
+	using namespace com::lowagie::text;
+	using namespace com::lowagie::text::pdf;
+}
+
+#include "pdftk.h"
+#include "report.h"
+
+static string
+jstring_to_string( jstring jss_p )
+{
+	string ret_val;
+	if( jss_p ) {
+		int buff_len= JvGetStringUTFLength( jss_p );
+		char* buff= (char*)malloc( buff_len* sizeof(char) ); // not NULL terminated
+		JvGetStringUTFRegion( jss_p, 0, jss_p->length(), buff );
+		ret_val.assign( buff, buff_len );
+		free( buff );
+	}
+	return ret_val;
+}
+
+static bool
+ends_with_nocase( const string& ss, const char* suffix )
+{
+	size_t suffix_len= strlen( suffix );
+	if( ss.size()< suffix_len )
+		return false;
+	for( size_t ii= 0; ii< suffix_len; ++ii ) {
+		if( tolower( ss[ ss.size()- suffix_len+ ii ] )!= tolower( suffix[ii] ) )
+			return false;
+	}
+	return true;
+}
+
+// locate the PDF Info dictionary that holds metadata
+static itext::PdfDictionary*
+get_info_dictionary( itext::PdfReader* reader_p )
+{
+	itext::PdfDictionary* trailer_p= reader_p->getTrailer();
+	if( trailer_p && trailer_p->isDictionary() ) {
+		itext::PdfDictionary* info_p= (itext::PdfDictionary*)
+			reader_p->getPdfObject( trailer_p->get( itext::PdfName::INFO ) );
+		if( info_p && info_p->isDictionary() ) {
+			return info_p;
+		}
+	}
+	return 0;
+}
+
+// burst into a single archive, instead of a file per page?
+bool
+TK_Session::is_burst_archive() const
+{
+	return( m_output_filename== "-" ||
+					ends_with_nocase( m_output_filename, ".tar" ) ||
+					ends_with_nocase( m_output_filename, ".zip" ) );
+}
+
+////
+// an uncompressed tar or zip (stored) archive, written in one pass to
+// a single stream; members are added whole, in the order given
+
+class BurstArchive {
+public:
+	BurstArchive( itext::OutputSink* sink_p, bool zip_b );
+
+	void add( const string& name, jbyteArray data_p );
+	void add( const string& name, const string& data );
+	// write the archive's trailer; the sink stays open
+	void finish();
+
+private:
+	struct ZipEntry {
+		string m_name;
+		jint m_crc;
+		jint m_size;
+		jlong m_offset;
+	};
+
+	void write( jint len ); // write len bytes of m_header_p
+	void put16( jint& pos, jint vv );
+	void put32( jint& pos, jint vv );
+	void put64( jint& pos, jlong vv );
+	void put_octal( jint pos, jint len, jlong vv );
+
+	void add_tar( const string& name, jbyteArray data_p );
+	void add_zip( const string& name, jbyteArray data_p );
+
+	itext::OutputSink* m_sink_p;
+	bool m_zip_b;
+	jbyteArray m_header_p; // scratch space for headers and padding
+	jlong m_offset; // bytes written so far
+	jlong m_mtime;
+	jint m_dos_time;
+	jint m_dos_date;
+	java::util::zip::CRC32* m_crc_p;
+	vector< ZipEntry > m_entries;
+};
+
+BurstArchive::BurstArchive( itext::OutputSink* sink_p, bool zip_b ) :
+	m_sink_p( sink_p ), m_zip_b( zip_b ),
+	m_header_p( JvNewByteArray( 512 ) ), m_offset( 0 ),
+	m_mtime( 0 ), m_dos_time( 0 ), m_dos_date( 0 ),
+	m_crc_p( new java::util::zip::CRC32() ), m_entries()
+{
+	// every member gets the time the burst began
+	time_t now= time( 0 );
+	m_mtime= now;
+	struct tm* tm_p= localtime( &now );
+	if( tm_p && 80<= tm_p->tm_year ) { // DOS dates begin in 1980
+		m_dos_time= ( tm_p->tm_hour<< 11 )| ( tm_p->tm_min<< 5 )| ( tm_p->tm_sec/ 2 );
+		m_dos_date= ( ( tm_p->tm_year- 80 )<< 9 )| ( ( tm_p->tm_mon+ 1 )<< 5 )| tm_p->tm_mday;
+	}
+}
+
+void
+BurstArchive::write( jint len )
+{
+	m_sink_p->write( m_header_p, 0, len );
+	m_offset+= len;
+}
+
+void
+BurstArchive::put16( jint& pos, jint vv )
+{
+	jbyte* bb= elements( m_header_p );
+	bb[pos++]= (jbyte)( vv );
+	bb[pos++]= (jbyte)( vv>> 8 );
+}
+
+void
+BurstArchive::put32( jint& pos, jint vv )
+{
+	put16( pos, vv );
+	put16( pos, vv>> 16 );
+}
+
+void
+BurstArchive::put64( jint& pos, jlong vv )
+{
+	put32( pos, (jint)vv );
+	put32( pos, (jint)( vv>> 32 ) );
+}
+
+// a NUL-terminated, zero-padded octal number, as tar likes them
+void
+BurstArchive::put_octal( jint pos, jint len, jlong vv )
+{
+	jbyte* bb= elements( m_header_p );
+	bb[ pos+ len- 1 ]= 0;
+	for( jint ii= len- 2; 0<= ii; --ii ) {
+		bb[ pos+ ii ]= (jbyte)( '0'+ ( vv& 7 ) );
+		vv>>= 3;
+	}
+}
+
+void
+BurstArchive::add( const string& name, jbyteArray data_p )
+{
+	if( m_zip_b ) {
+		add_zip( name, data_p );
+	}
+	else {
+		add_tar( name, data_p );
+	}
+}
+
+void
+BurstArchive::add( const string& name, const string& data )
+{
+	jbyteArray data_p= JvNewByteArray( data.size() );
+	memcpy( elements( data_p ), data.data(), data.size() );
+	add( name, data_p );
+}
+
+void
+BurstArchive::add_tar( const string& name, jbyteArray data_p )
+{
+	if( 100< name.size() ) {
+		throw new java::io::IOException( JvNewStringUTF( ( "name too long for a tar archive: "+ name ).c_str() ) );
+	}
+
+	// a ustar header
+	jbyte* bb= elements( m_header_p );
+	memset( bb, 0, 512 );
+	memcpy( bb, name.data(), name.size() );
+	put_octal( 100, 8, 0644 ); // mode
+	put_octal( 108, 8, 0 ); // uid
+	put_octal( 116, 8, 0 ); // gid
+	put_octal( 124, 12, data_p->length );
+	put_octal( 136, 12, m_mtime );
+	memset( bb+ 148, ' ', 8 ); // the checksum counts itself as spaces
+	bb[156]= '0'; // a regular file
+	memcpy( bb+ 257, "ustar", 6 );
+	memcpy( bb+ 263, "00", 2 );
+
+	jint sum= 0;
+	for( int ii= 0; ii< 512; ++ii ) {
+		sum+= (unsigned char)bb[ii];
+	}
+	put_octal( 148, 7, sum );
+
+	write( 512 );
+	m_sink_p->write( data_p, 0, data_p->length );
+	m_offset+= data_p->length;
+
+	// pad the member to a whole block
+	jint pad= ( 512- data_p->length% 512 )% 512;
+	if( pad ) {
+		memset( bb, 0, pad );
+		write( pad );
+	}
+}
+
+void
+BurstArchive::add_zip( const string& name, jbyteArray data_p )
+{
+	if( 400< name.size() ) { // it must fit in m_header_p
+		throw new java::io::IOException( JvNewStringUTF( ( "name too long for a zip archive: "+ name ).c_str() ) );
+	}
+
+	ZipEntry entry;
+	entry.m_name= name;
+	m_crc_p->reset();
+	m_crc_p->update( data_p, 0, data_p->length );
+	entry.m_crc= (jint)m_crc_p->getValue();
+	entry.m_size= data_p->length;
+	entry.m_offset= m_offset;
+
+	// the local file header; a member is never larger than 4GB, so
+	// only its offset might need zip64, and that's in the central directory
+	jint pos= 0;
+	put32( pos, 0x04034b50 );
+	put16( pos, 20 ); // version needed
+	put16( pos, 0 ); // flags
+	put16( pos, 0 ); // stored
+	put16( pos, m_dos_time );
+	put16( pos, m_dos_date );
+	put32( pos, entry.m_crc );
+	put32( pos, entry.m_size ); // compressed
+	put32( pos, entry.m_size ); // uncompressed
+	put16( pos, name.size() );
+	put16( pos, 0 ); // extra field length
+	memcpy( elements( m_header_p )+ pos, name.data(), name.size() );
+	write( pos+ name.size() );
+
+	m_sink_p->write( data_p, 0, data_p->length );
+	m_offset+= data_p->length;
+
+	m_entries.push_back( entry );
+}
+
+void
+BurstArchive::finish()
+{
+	if( !m_zip_b ) {
+		// two empty blocks end a tar archive
+		memset( elements( m_header_p ), 0, 512 );
+		write( 512 );
+		write( 512 );
+		return;
+	}
+
+	// the central directory
+	jlong dir_offset= m_offset;
+	for( vector< ZipEntry >::const_iterator it= m_entries.begin(); it!= m_entries.end(); ++it ) {
+		bool zip64_b= ( 0xffffffffLL<= it->m_offset );
+		jint pos= 0;
+		put32( pos, 0x02014b50 );
+		put16( pos, ( 3<< 8 )| 45 ); // made by unix, zip 4.5
+		put16( pos, zip64_b ? 45 : 20 ); // version needed
+		put16( pos, 0 ); // flags
+		put16( pos, 0 ); // stored
+		put16( pos, m_dos_time );
+		put16( pos, m_dos_date );
+		put32( pos, it->m_crc );
+		put32( pos, it->m_size );
+		put32( pos, it->m_size );
+		put16( pos, it->m_name.size() );
+		put16( pos, zip64_b ? 12 : 0 ); // extra field length
+		put16( pos, 0 ); // comment length
+		put16( pos, 0 ); // disk number
+		put16( pos, 0 ); // internal attributes
+		put32( pos, (jint)( 0100644u<< 16 ) ); // external attributes: a regular file, rw-r--r--
+		put32( pos, zip64_b ? (jint)0xffffffff : (jint)it->m_offset );
+		memcpy( elements( m_header_p )+ pos, it->m_name.data(), it->m_name.size() );
+		pos+= it->m_name.size();
+		if( zip64_b ) {
+			put16( pos, 0x0001 );
+			put16( pos, 8 );
+			put64( pos, it->m_offset );
+		}
+		write( pos );
+	}
+	jlong dir_size= m_offset- dir_offset;
+	jlong num_entries= m_entries.size();
+
+	if( 0xffff<= num_entries || 0xffffffffLL<= dir_offset ) {
+		// zip64 end of central directory record, and its locator
+		jlong record_offset= m_offset;
+		jint pos= 0;
+		put32( pos, 0x06064b50 );
+		put64( pos, 44 ); // size of the rest of this record
+		put16( pos, ( 3<< 8 )| 45 );
+		put16( pos, 45 );
+		put32( pos, 0 ); // this disk
+		put32( pos, 0 ); // the central directory's disk
+		put64( pos, num_entries ); // on this disk
+		put64( pos, num_entries ); // in all
+		put64( pos, dir_size );
+		put64( pos, dir_offset );
+		put32( pos, 0x07064b50 );
+		put32( pos, 0 ); // the record's disk
+		put64( pos, record_offset );
+		put32( pos, 1 ); // disks
+		write( pos );
+
+		num_entries= 0xffff;
+		dir_offset= 0xffffffffLL;
+	}
+
+	// end of central directory record
+	jint pos= 0;
+	put32( pos, 0x06054b50 );
+	put16( pos, 0 ); // this disk
+	put16( pos, 0 ); // the central directory's disk
+	put16( pos, (jint)num_entries ); // on this disk
+	put16( pos, (jint)num_entries ); // in all
+	put32( pos, (jint)dir_size );
+	put32( pos, (jint)dir_offset );
+	put16( pos, 0 ); // comment length
+	write( pos );
+}
+
+////
+// the parts a burst writes; each part is a run of pages, and it gets
+// its own output PDF, so resources its pages share are written once
+
+// find the first page of each part, in order, and append one past the
+// last page; return false on error
+bool
+TK_Session::get_burst_part_starts( itext::PdfReader* input_reader_p,
+																	 jint num_pages,
+																	 vector< jint >& part_starts )
+{
+	set< jint > starts;
+	starts.insert( 1 );
+
+	if( !m_burst_at_pages_filename.empty() ) {
+		ifstream ifs( m_burst_at_pages_filename.c_str() );
+		if( !ifs ) {
+			cerr << "Error: unable to open file for input: " << m_burst_at_pages_filename << endl;
+			return false;
+		}
+		string token;
+		while( ifs >> token ) {
+			char* end_p= 0;
+			long page_num= strtol( token.c_str(), &end_p, 10 );
+			if( *end_p || page_num< 1 || num_pages< page_num ) {
+				cerr << "Error: unexpected page number in: " << m_burst_at_pages_filename << endl;
+				cerr << "   " << token << " (the input has " << num_pages << " pages)" << endl;
+				return false;
+			}
+			starts.insert( (jint)page_num );
+		}
+	}
+	else if( m_burst_at_bookmarks_b ) {
+		// a part begins at each top-level bookmark's page
+		itext::PdfDictionary* catalog_p= input_reader_p->getCatalog();
+		itext::PdfDictionary* outlines_p= (itext::PdfDictionary*)
+			input_reader_p->getPdfObject( catalog_p->get( itext::PdfName::OUTLINES ) );
+		if( outlines_p && outlines_p->isDictionary() ) {
+			itext::PdfDictionary* outline_p= (itext::PdfDictionary*)
+				input_reader_p->getPdfObject( outlines_p->get( itext::PdfName::FIRST ) );
+			set< itext::PdfDictionary* > seen; // a damaged outline might loop
+			while( outline_p && outline_p->isDictionary() && seen.insert( outline_p ).second ) {
+				jint page_num= GetOutlinePageNumber( outline_p, input_reader_p );
+				if( 0< page_num && page_num<= num_pages ) { // zero: no page destination
+					starts.insert( page_num );
+				}
+				outline_p= (itext::PdfDictionary*)
+					input_reader_p->getPdfObject( outline_p->get( itext::PdfName::NEXT ) );
+			}
+		}
+		else if( m_verbose_reporting_b ) {
+			cerr << "Warning: the input has no bookmarks, so it's written as one part." << endl;
+		}
+	}
+	else {
+		// count in a jlong, so a large every doesn't wrap past num_pages
+		for( jlong page_num= 1+ (jlong)m_burst_every; page_num<= num_pages; page_num+= m_burst_every ) {
+			starts.insert( (jint)page_num );
+		}
+	}
+
+	part_starts.assign( starts.begin(), starts.end() );
+	if( num_pages< 1 ) { // no parts
+		part_starts.clear();
+	}
+	part_starts.push_back( num_pages+ 1 );
+
+	return true;
+}
+
+////
+// the state shared by the workers of a burst
+
+struct BurstJob {
+	itext::PdfReader* m_reader_p; // the session's reader; only the first worker uses it
+	jbyteArray m_input_pw_p; // opens each extra worker's own reader
+	vector< jint > m_part_starts; // each part's first page, 1-based, then one past the last page
+	jint m_num_parts;
+	jint m_chunk_size; // parts a worker takes at a time
+	string m_name_pattern; // one %d or %0Nd, numbering the output files
+	java::String* m_creator_p;
+	jbyteArray m_output_user_pw_p;
+	jbyteArray m_output_owner_pw_p;
+	TK_Session* m_session_p;
+
+	java::lang::Object* m_lock_p; // guards the members below, and cerr
+	jint m_next_part; // zero-based
+	vector< jint > m_returned_parts; // taken by a worker that died; last first
+	bool m_stopped_b; // a part failed, so no more are taken
+	jint m_num_written;
+	jint m_objstm_count;
+	jint m_objstm_objects;
+	jint m_objstm_saved;
+
+	// when bursting into an archive, the parts are added in order, so a
+	// part that's done early waits here until the parts before it are added;
+	// workers wait on m_lock_p rather than take more than m_archive_window
+	// parts ahead of the archive, which bounds the parts held in memory
+	BurstArchive* m_archive_p;
+	java::util::HashMap* m_done_parts_p; // Integer part index -> PDF bytes
+	jint m_next_archived; // zero-based
+	jint m_archive_window;
+	bool m_archiving_b; // a part is going into the archive
+};
+
+bool
+TK_Session::burst_part( BurstJob& job,
+												itext::PdfReader* input_reader_p,
+												itext::PdfDictionary* input_info_p,
+												jint ii )
+{
+	// the filename
+	char buff[4096]= "";
+	snprintf( buff, sizeof(buff), job.m_name_pattern.c_str(), ii+ 1 );
+
+	itext::OutputSink* ofs_p= 0;
+	java::ByteArrayOutputStream* bytes_p= 0;
+	try {
+		itext::Document* output_doc_p= new itext::Document();
+		itext::PdfCopy* writer_p= 0;
+		if( job.m_archive_p ) { // the part waits in memory for its turn
+			bytes_p= new java::ByteArrayOutputStream();
+			writer_p= new itext::PdfCopy( output_doc_p, bytes_p );
+		}
+		else {
+			ofs_p= open_output_sink( new java::FileOutputStream( JvNewStringUTF( buff ) ) );
+			writer_p= new itext::PdfCopy( output_doc_p, ofs_p );
+		}
+
+		output_doc_p->addCreator( job.m_creator_p );
+
+		// un/compress output streams?
+		if( m_output_uncompress_b ) {
+			writer_p->filterStreams= true;
+			writer_p->compressStreams= false;
+		}
+		else if( m_output_compress_b ) {
+			writer_p->filterStreams= false;
+			writer_p->compressStreams= true;
+		}
+
+		// pack objects into object streams?
+		if( m_output_compress_objects_b ) {
+			writer_p->setFullCompression();
+			writer_p->setObjectsPerStream( m_output_objects_per_stream );
+		}
+
+		// copy only the resources each page uses?
+		if( m_output_prune_resources_b ) {
+			writer_p->pruneResources= true;
+		}
+
+		// encrypt output?
+		if( is_output_encrypted() )
+			{
+				// if no stregth is given, default to 128 bit,
+				// (which is incompatible w/ Acrobat 4)
+				writer_p->setEncryption( job.m_output_user_pw_p,
+																 job.m_output_owner_pw_p,
+																 m_output_user_perms,
+																 output_encryption_type() );
+			}
+
+		{ // copy the Info dictionary metadata
+			if( input_info_p ) {
+				itext::PdfDictionary* writer_info_p= writer_p->getInfo();
+				itext::PdfDictionary* info_copy_p= writer_p->copyDictionary( input_info_p );
+				if( writer_info_p && info_copy_p ) {
+					writer_info_p->putAll( info_copy_p );
+				}
+			}
+			jbyteArray input_reader_xmp_p= input_reader_p->getMetadata();
+			if( input_reader_xmp_p ) {
+				writer_p->setXmpMetadata( input_reader_xmp_p );
+			}
+		}
+
+		output_doc_p->open();
+
+		for( jint page_num= job.m_part_starts[ii]; page_num< job.m_part_starts[ii+ 1]; ++page_num ) {
+			input_reader_p->consolidateNamedDestinations( page_num ); // resolve its named links
+			itext::PdfImportedPage* page_p=
+				writer_p->getImportedPage( input_reader_p, page_num );
+			writer_p->addPage( page_p );
+		}
+
+		output_doc_p->close();
+		writer_p->close();
+
+		{
+			JvSynchronize sync( job.m_lock_p );
+			close_output_sink( ofs_p ); // for its byte count
+			if( m_output_compress_objects_b ) {
+				job.m_objstm_count+= writer_p->getObjectStreamCount();
+				job.m_objstm_objects+= writer_p->getObjectStreamObjects();
+				job.m_objstm_saved+= writer_p->getObjectStreamSavings();
+			}
+
+			if( job.m_archive_p ) {
+				job.m_done_parts_p->put( new java::lang::Integer( ii ), bytes_p->toByteArray() );
+				bytes_p= 0;
+
+				// add every part that's no longer waiting on an earlier one
+				jint next_archived= job.m_next_archived;
+				job.m_archiving_b= true;
+				for( ;; ) {
+					jbyteArray part_bytes_p= (jbyteArray)
+						job.m_done_parts_p->remove( new java::lang::Integer( job.m_next_archived ) );
+					if( !part_bytes_p ) {
+						break;
+					}
+					char name[4096]= "";
+					snprintf( name, sizeof(name), job.m_name_pattern.c_str(), job.m_next_archived+ 1 );
+					job.m_archive_p->add( name, part_bytes_p );
+					++job.m_next_archived;
+				}
+				job.m_archiving_b= false;
+				if( next_archived< job.m_next_archived ) { // room for more parts
+					job.m_lock_p->notifyAll();
+				}
+			}
+		}
+	}
+	catch( java::lang::Exception* e_p ) {
+		{
+			JvSynchronize sync( job.m_lock_p );
+			jint first_page= job.m_part_starts[ii], last_page= job.m_part_starts[ii+ 1]- 1;
+			if( first_page== last_page ) {
+				cerr << "Error: failed to write page " << first_page << " to: " << buff << endl;
+			}
+			else {
+				cerr << "Error: failed to write pages " << first_page << "-" << last_page << " to: " << buff << endl;
+			}
+			jstring msg_p= e_p->getMessage();
+			if( msg_p ) {
+				cerr << "   " << jstring_to_string( msg_p ) << endl;
+			}
+		}
+		if( ofs_p ) {
+			try {
+				ofs_p->close();
+			}
+			catch( java::io::IOException* ioe_p ) {
+			}
+			( new java::File( JvNewStringUTF( buff ) ) )->delete$();
+		}
+		return false;
+	}
+
+	return true;
+}
+
+// take chunks of parts until none are left; a failure ends the burst,
+// like it does when the parts are written one after another; a worker
+// that dies gives back the parts it took but didn't write
+void
+TK_Session::burst_parts( BurstJob& job,
+												 itext::PdfReader* input_reader_p )
+{
+	itext::PdfDictionary* input_info_p= get_info_dictionary( input_reader_p );
+
+	for( ;; ) {
+		jint first= 0, last= 0;
+		{
+			JvSynchronize sync( job.m_lock_p );
+			while( job.m_archive_p &&
+					!job.m_stopped_b &&
+					job.m_returned_parts.empty() &&
+					job.m_next_part< job.m_num_parts &&
+					job.m_archive_window<= job.m_next_part- job.m_next_archived )
+				{ // let the archive catch up
+					job.m_lock_p->wait();
+				}
+			if( job.m_stopped_b ) {
+				break;
+			}
+			if( !job.m_returned_parts.empty() ) { // one at a time, in order
+				first= job.m_returned_parts.back();
+				job.m_returned_parts.pop_back();
+				last= first+ 1;
+			}
+			else if( job.m_num_parts<= job.m_next_part ) {
+				break;
+			}
+			else {
+				first= job.m_next_part;
+				last= first+ job.m_chunk_size;
+				if( job.m_num_parts< last ) {
+					last= job.m_num_parts;
+				}
+				job.m_next_part= last;
+			}
+		}
+
+		jint ii= first;
+		try {
+			for( ; ii< last; ++ii ) {
+				if( burst_part( job, input_reader_p, input_info_p, ii ) ) {
+					JvSynchronize sync( job.m_lock_p );
+					++job.m_num_written;
+				}
+				else {
+					JvSynchronize sync( job.m_lock_p );
+					job.m_stopped_b= true; // stop the others, too
+					job.m_lock_p->notifyAll();
+					break;
+				}
+			}
+		}
+		catch( java::lang::Throwable* t_p ) {
+			JvSynchronize sync( job.m_lock_p );
+			if( job.m_archiving_b ) { // the archive may end in part of a member
+				job.m_stopped_b= true;
+			}
+			else if( !job.m_stopped_b ) {
+				for( jint kk= last- 1; ii<= kk; --kk ) {
+					job.m_returned_parts.push_back( kk );
+				}
+			}
+			job.m_lock_p->notifyAll();
+			throw t_p;
+		}
+	}
+}
+
+#ifdef USE_PTHREADS
+// the body of each extra worker thread; arg_p is the BurstJob
+void*
+TK_Session::burst_worker( void* arg_p )
+{
+	BurstJob* job_p= (BurstJob*)arg_p;
+
+	// make this thread known to the Java runtime and its collector
+	JvAttachCurrentThread( 0, 0 );
+	try {
+		// our own reader of the same file, so we needn't share its file
+		// position or its objects with the other workers; opening it in
+		// partial mode only reads the xref
+		itext::PdfReader* reader_p=
+			new itext::PdfReader( job_p->m_reader_p->getSafeFile(), job_p->m_input_pw_p, true );
+
+		job_p->m_session_p->burst_parts( *job_p, reader_p );
+
+		reader_p->close();
+	}
+	catch( java::lang::Throwable* t_p ) {
+		// burst_parts() gave our unwritten parts back to the other workers
+		JvSynchronize sync( job_p->m_lock_p );
+		cerr << "Warning: a burst worker stopped early; the others take its parts." << endl;
+		if( job_p->m_session_p->m_verbose_reporting_b ) {
+			t_p->printStackTrace();
+		}
+	}
+	JvDetachCurrentThread();
+
+	return 0;
+}
+#endif
+
+int
+TK_Session::burst( itext::PdfReader* input_reader_p,
+									 itext::OutputSink* archive_sink_p,
+									 java::String* jv_creator_p,
+									 jbyteArray output_user_pw_p,
+									 jbyteArray output_owner_pw_p,
+									 jint& objstm_count,
+									 jint& objstm_objects,
+									 jint& objstm_saved )
+{
+	int ret_val= 0;
+
+	InputPdf& input_pdf= *m_input_pdf.begin();
+
+	BurstJob job;
+	job.m_reader_p= input_reader_p;
+	job.m_input_pw_p= 0;
+	if( !input_pdf.m_password.empty() ) {
+		job.m_input_pw_p= JvNewByteArray( input_pdf.m_password.size() );
+		memcpy( (char*)(elements(job.m_input_pw_p)),
+						input_pdf.m_password.c_str(),
+						input_pdf.m_password.size() );
+	}
+	if( !get_burst_part_starts( input_reader_p, (jint)input_pdf.m_num_pages, job.m_part_starts ) ) {
+		cerr << "   No output created." << endl;
+		return 1;
+	}
+	job.m_num_parts= job.m_part_starts.size()- 1;
+	job.m_chunk_size= 1;
+	job.m_name_pattern= archive_sink_p ? string( "pg_%04d.pdf" ) : m_output_filename;
+	job.m_creator_p= jv_creator_p;
+	job.m_output_user_pw_p= output_user_pw_p;
+	job.m_output_owner_pw_p= output_owner_pw_p;
+	job.m_session_p= this;
+	job.m_lock_p= new java::lang::Object();
+	job.m_next_part= 0;
+	job.m_stopped_b= false;
+	job.m_num_written= 0;
+	job.m_objstm_count= 0;
+	job.m_objstm_objects= 0;
+	job.m_objstm_saved= 0;
+
+	BurstArchive archive( archive_sink_p, ends_with_nocase( m_output_filename, ".zip" ) );
+	job.m_archive_p= archive_sink_p ? &archive : 0;
+	job.m_done_parts_p= new java::util::HashMap();
+	job.m_next_archived= 0;
+	job.m_archive_window= 1;
+	job.m_archiving_b= false;
+
+	// one worker per processor, each with its own reader; parts are
+	// independent, so this scales until the disk can't keep up
+	size_t num_workers= 1;
+#ifdef USE_PTHREADS
+	num_workers= java::Runtime::getRuntime()->availableProcessors();
+	if( (size_t)job.m_num_parts< num_workers ) {
+		num_workers= job.m_num_parts;
+	}
+	if( num_workers< 1 ) {
+		num_workers= 1;
+	}
+#endif
+
+	// hand out runs of neighbouring parts, which often share fonts and
+	// images that a worker's reader then reads only once; keep the runs
+	// short enough that the workers finish at about the same time; an
+	// archive takes its parts in order, so there a worker takes one at a
+	// time and stays no more than a couple of parts per worker ahead
+	if( job.m_archive_p ) {
+		job.m_archive_window= 2* num_workers;
+	}
+	else if( 1< num_workers ) {
+		job.m_chunk_size= job.m_num_parts/ ( num_workers* 8 );
+		if( 64< job.m_chunk_size ) {
+			job.m_chunk_size= 64;
+		}
+		if( job.m_chunk_size< 1 ) {
+			job.m_chunk_size= 1;
+		}
+	}
+
+	// the workers already keep the processors busy, so don't also give
+	// each output its own deflate threads
+	jint deflate_threads= itext::PdfWriter::deflateThreads;
+	if( 1< num_workers ) {
+		itext::PdfWriter::deflateThreads= 1;
+	}
+
+	jlong start_ms= java::System::currentTimeMillis();
+
+#ifdef USE_PTHREADS
+	vector< pthread_t > workers;
+	for( size_t ii= 1; ii< num_workers; ++ii ) { // this thread is a worker, too
+		pthread_t worker;
+		if( pthread_create( &worker, 0, burst_worker, &job )== 0 ) {
+			workers.push_back( worker );
+		}
+		else { // make do with what we have
+			break;
+		}
+	}
+	num_workers= workers.size()+ 1;
+#endif
+
+	for( int pass= 0; pass< 2; ++pass ) {
+		try {
+			burst_parts( job, input_reader_p );
+		}
+		catch( java::lang::Throwable* t_p ) { // wait for the other workers, anyhow
+			JvSynchronize sync( job.m_lock_p );
+			cerr << "Unhandled Java Exception in a burst worker:" << endl;
+			t_p->printStackTrace();
+		}
+
+#ifdef USE_PTHREADS
+		for( vector< pthread_t >::iterator it= workers.begin(); it!= workers.end(); ++it ) {
+			pthread_join( *it, 0 );
+		}
+		workers.clear();
+#endif
+
+		// once more, for any parts given back after the other workers finished
+		if( job.m_stopped_b || job.m_returned_parts.empty() ) {
+			break;
+		}
+	}
+
+	itext::PdfWriter::deflateThreads= deflate_threads;
+
+	objstm_count+= job.m_objstm_count;
+	objstm_objects+= job.m_objstm_objects;
+	objstm_saved+= job.m_objstm_saved;
+
+	if( job.m_archive_p ) { // parts done after a failure never got their turn
+		job.m_num_written= job.m_next_archived;
+	}
+	if( job.m_num_written< job.m_num_parts ) {
+		cerr << "Error: wrote " << job.m_num_written << " of " << job.m_num_parts << " parts." << endl;
+		ret_val= 1;
+	}
+
+	////
+	// dump document data
+
+	if( job.m_archive_p && ret_val ) { // don't finish it as though it were whole
+		try {
+			close_output_sink( archive_sink_p );
+		}
+		catch( java::io::IOException* ioe_p ) {
+		}
+		if( m_output_filename!= "-" ) {
+			( new java::File( JvNewStringUTF( m_output_filename.c_str() ) ) )->delete$();
+			cerr << "   The incomplete archive was removed: " << m_output_filename << endl;
+		}
+		else {
+			cerr << "   The archive on stdout is incomplete." << endl;
+		}
+	}
+	else if( job.m_archive_p ) {
+		ostringstream oss;
+		ReportOnPdf( oss, input_reader_p, m_output_utf8_b );
+		try {
+			archive.add( "doc_data.txt", oss.str() );
+			archive.finish();
+			close_output_sink( archive_sink_p );
+		}
+		catch( java::io::IOException* ioe_p ) {
+			cerr << "Error: failed to write the archive: " << m_output_filename << endl;
+			jstring msg_p= ioe_p->getMessage();
+			if( msg_p ) {
+				cerr << "   " << jstring_to_string( msg_p ) << endl;
+			}
+			ret_val= 1;
+		}
+	}
+	else {
+		ofstream ofs( "doc_data.txt" );
+		if( ofs ) {
+			ReportOnPdf( ofs, input_reader_p, m_output_utf8_b );
+		}
+		else { // error
+			cerr << "Error: unable to open file for output: doc_data.txt" << endl;
+			ret_val= 1;
+		}
+	}
+
+	if( m_verbose_reporting_b ) {
+		jlong elapsed_ms= java::System::currentTimeMillis()- start_ms;
+		cout << "Wrote " << job.m_num_written << " of " << job.m_num_parts;
+		cout << ( job.m_num_parts== (jint)input_pdf.m_num_pages ? " pages" : " parts" );
+		if( 0< elapsed_ms ) {
+			cout << " in " << elapsed_ms/ 1000.0 << " seconds";
+		}
+		if( 1< num_workers ) {
+			cout << ", using " << num_workers << " threads";
+		}
+		cout << "." << endl;
+	}
+
+	return ret_val;
+}
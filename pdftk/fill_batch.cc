@@ -0,0 +1,670 @@
+/* -*- Mode: C++; tab-width: 2; c-basic-offset: 2 -*- */
+/*
+	pdftk, the PDF Toolkit
+	Copyright (c) 2003, 2004, 2010 Sid Steward
+
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+	Visit: www.pdftk.com for pdftk information and articles
+	Permalink: http://www.pdflabs.com/tools/pdftk-the-pdf-toolkit/
+
+	Please email Sid Steward with questions or bug reports.
+	Include "pdftk" in the subject line to ensure successful delivery:
+	sid.steward at pdflabs dot com
+
+*/
+
+// Tell C++ compiler to use Java-style exceptions.
+#pragma GCC java_exceptions
+
+#include <gcj/cni.h>
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <map>
+#include <vector>
+#include <set>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+
+#ifdef USE_PTHREADS
+#include <pthread.h>
+#endif
+
+#include <java/lang/System.h>
+#include <java/lang/Throwable.h>
+#include <java/lang/Exception.h>
+#include <java/lang/String.h>
+#include <java/lang/Runtime.h>
+#include <java/io/IOException.h>
+#include <java/io/File.h>
+#include <java/io/FileOutputStream.h>
+#include <java/util/Arrays.h>
+#include <java/util/HashMap.h>
+
+#include "com/lowagie/text/Document.h"
+#include "com/lowagie/text/Rectangle.h"
+#include "com/lowagie/text/pdf/PdfName.h"
+#include "com/lowagie/text/pdf/PdfObject.h"
+#include "com/lowagie/text/pdf/PdfDictionary.h"
+#include "com/lowagie/text/pdf/PdfBoolean.h"
+#include "com/lowagie/text/pdf/PdfCopy.h"
+#include "com/lowagie/text/pdf/PdfReader.h"
+#include "com/lowagie/text/pdf/PdfWriter.h"
+#include "com/lowagie/text/pdf/PdfStamperImp.h"
+#include "com/lowagie/text/pdf/FdfReader.h"
+#include "com/lowagie/text/pdf/XfdfReader.h"
+#include "com/lowagie/text/pdf/AcroFields.h"
+#include "com/lowagie/text/pdf/OutputSink.h"
+
+#include <gcj/array.h>
+
+using namespace std;
+
+namespace java {
+	using namespace java::lang;
+	using namespace java::io;
+	using namespace java::util;
+}
+
+namespace itext {
+	using namespace com::lowagie::text;
+	using namespace com::lowagie::text::pdf;
+}
+
+#include "pdftk.h"
+
+static string
+jstring_to_string( jstring jss_p )
+{
+	string ret_val;
+	if( jss_p ) {
+		int buff_len= JvGetStringUTFLength( jss_p );
+		char* buff= (char*)malloc( buff_len* sizeof(char) ); // not NULL terminated
+		JvGetStringUTFRegion( jss_p, 0, jss_p->length(), buff );
+		ret_val.assign( buff, buff_len );
+		free( buff );
+	}
+	return ret_val;
+}
+
+static bool
+ends_with_nocase( const string& ss, const char* suffix )
+{
+	size_t suffix_len= strlen( suffix );
+	if( ss.size()< suffix_len )
+		return false;
+	for( size_t ii= 0; ii< suffix_len; ++ii ) {
+		if( tolower( ss[ ss.size()- suffix_len+ ii ] )!= tolower( suffix[ii] ) )
+			return false;
+	}
+	return true;
+}
+
+static bool
+is_directory( const string& filename )
+{
+	return ( new java::File( JvNewStringUTF( filename.c_str() ) ) )->isDirectory();
+}
+
+////
+// parse CSV data, per RFC 4180: fields separated by commas, rows by
+// CRLF or LF; a field in double quotes may hold commas, line breaks
+// and doubled "" quotes; return false on an unterminated quote
+
+static bool
+parse_csv( istream& ifs, vector< vector< string > >& rows )
+{
+	vector< string > row;
+	string field;
+	bool quoted_b= false; // inside a quoted field
+	bool field_b= false; // row has any data
+	int cc= 0;
+	while( ( cc= ifs.get() )!= EOF ) {
+		if( quoted_b ) {
+			if( cc== '"' ) {
+				if( ifs.peek()== '"' ) {
+					field+= (char)ifs.get();
+				}
+				else {
+					quoted_b= false;
+				}
+			}
+			else {
+				field+= (char)cc;
+			}
+		}
+		else if( cc== '"' ) {
+			quoted_b= true;
+			field_b= true;
+		}
+		else if( cc== ',' ) {
+			row.push_back( field );
+			field.clear();
+			field_b= true;
+		}
+		else if( cc== '\n' || cc== '\r' ) {
+			if( cc== '\r' && ifs.peek()== '\n' ) {
+				ifs.get();
+			}
+			if( field_b || !field.empty() ) { // skip blank lines
+				row.push_back( field );
+				rows.push_back( row );
+			}
+			row.clear();
+			field.clear();
+			field_b= false;
+		}
+		else {
+			field+= (char)cc;
+			field_b= true;
+		}
+	}
+	if( field_b || !field.empty() ) { // no line break at the end
+		row.push_back( field );
+		rows.push_back( row );
+	}
+
+	// drop a UTF-8 byte order mark
+	if( !rows.empty() && !rows[0].empty() &&
+			rows[0][0].compare( 0, 3, "\xEF\xBB\xBF" )== 0 )
+		{
+			rows[0][0].erase( 0, 3 );
+		}
+
+	return !quoted_b;
+}
+
+////
+// the records of a batch fill_form: a directory of FDF and XFDF
+// files, a CSV file with a header row of field names, or an FDF or
+// XFDF file (XFDF may hold several <fields> elements, one per record)
+
+class FormRecords {
+public:
+	FormRecords() : m_xfdf_reader_p( 0 ), m_fdf_reader_p( 0 ) {}
+
+	// load the record list; report any error to cerr; an XFDF file the
+	// caller already opened may be given as xfdf_reader_p
+	bool load( const string& filename, itext::XfdfReader* xfdf_reader_p= 0 );
+
+	size_t size() const;
+
+	// names record ii, for error messages
+	string label( size_t ii ) const;
+
+	// set the fields of record ii; return true iff it has Rich Text
+	bool fill( size_t ii, itext::AcroFields* fields_p );
+
+private:
+	string m_filename;
+	vector< string > m_record_filenames; // directory: one file per record
+	vector< vector< string > > m_csv_rows; // CSV: the header, then one row per record
+	itext::XfdfReader* m_xfdf_reader_p;
+	itext::FdfReader* m_fdf_reader_p;
+};
+
+bool
+FormRecords::load( const string& filename,
+									 itext::XfdfReader* xfdf_reader_p )
+{
+	m_filename= filename;
+
+	if( xfdf_reader_p ) {
+		m_xfdf_reader_p= xfdf_reader_p;
+	}
+	else if( is_directory( filename ) ) {
+		const char path_delim= PATH_DELIM; // given at compile-time
+		JArray< jstring >* names_p=
+			( new java::File( JvNewStringUTF( filename.c_str() ) ) )->list();
+		if( names_p ) {
+			java::Arrays::sort( (JArray< java::Object* >*)names_p );
+			jstring* name_pp= elements( names_p );
+			for( jint ii= 0; ii< names_p->length; ++ii ) {
+				string name= jstring_to_string( name_pp[ii] );
+				if( ends_with_nocase( name, ".fdf" ) || ends_with_nocase( name, ".xfdf" ) ) {
+					m_record_filenames.push_back( filename+ path_delim+ name );
+				}
+			}
+		}
+		if( m_record_filenames.empty() ) {
+			cerr << "Error: no FDF or XFDF files found in directory: " << endl;
+			cerr << "   " << filename << endl;
+			return false;
+		}
+	}
+	else if( ends_with_nocase( filename, ".csv" ) ) {
+		ifstream ifs( filename.c_str(), ios::in | ios::binary );
+		if( !ifs ) {
+			cerr << "Error: Failed to open form data file: " << endl;
+			cerr << "   " << filename << endl;
+			return false;
+		}
+		if( !parse_csv( ifs, m_csv_rows ) ) {
+			cerr << "Error: unterminated quoted field in CSV form data file: " << endl;
+			cerr << "   " << filename << endl;
+			return false;
+		}
+		if( m_csv_rows.size()< 2 ) {
+			cerr << "Error: CSV form data needs a header row of field names," << endl;
+			cerr << "   followed by one row per record: " << filename << endl;
+			return false;
+		}
+	}
+	else if( !open_form_data( filename, false, m_fdf_reader_p, m_xfdf_reader_p ) ) {
+		cerr << "Error: Failed to open form data file: " << endl;
+		cerr << "   " << filename << endl;
+		return false;
+	}
+
+	return true;
+}
+
+size_t
+FormRecords::size() const
+{
+	if( !m_record_filenames.empty() )
+		return m_record_filenames.size();
+	if( !m_csv_rows.empty() )
+		return m_csv_rows.size()- 1;
+	if( m_xfdf_reader_p )
+		return ( m_xfdf_reader_p->getRecordCount()> 1 ) ? m_xfdf_reader_p->getRecordCount() : 1;
+	return 1;
+}
+
+string
+FormRecords::label( size_t ii ) const
+{
+	if( !m_record_filenames.empty() )
+		return m_record_filenames[ii];
+
+	char buff[64]= "";
+	sprintf( buff, " record %lu", (unsigned long)( ii+ 1 ) );
+	return m_filename+ buff;
+}
+
+bool
+FormRecords::fill( size_t ii, itext::AcroFields* fields_p )
+{
+	if( !m_record_filenames.empty() ) {
+		itext::FdfReader* fdf_reader_p= 0;
+		itext::XfdfReader* xfdf_reader_p= 0;
+		if( !open_form_data( m_record_filenames[ii], false, fdf_reader_p, xfdf_reader_p ) ) {
+			throw new java::io::IOException( JvNewStringUTF( "not an FDF or XFDF file" ) );
+		}
+		return fdf_reader_p ? fields_p->setFields( fdf_reader_p ) : fields_p->setFields( xfdf_reader_p );
+	}
+	else if( !m_csv_rows.empty() ) {
+		const vector< string >& header= m_csv_rows[0];
+		const vector< string >& row= m_csv_rows[ii+ 1];
+		for( size_t jj= 0; jj< header.size() && jj< row.size(); ++jj ) {
+			if( !header[jj].empty() ) {
+				fields_p->setField( JvNewStringUTF( header[jj].c_str() ),
+														JvNewStringUTF( row[jj].c_str() ) );
+			}
+		}
+		return false;
+	}
+	else if( m_xfdf_reader_p ) {
+		if( 1< m_xfdf_reader_p->getRecordCount() )
+			return fields_p->setFields( m_xfdf_reader_p->getRecord( (jint)ii ) );
+		return fields_p->setFields( m_xfdf_reader_p );
+	}
+	return fields_p->setFields( m_fdf_reader_p );
+}
+
+////
+// batch fill_form
+
+// a directory or a CSV file is always a batch; so is an XFDF file
+// with more than one record, which the caller finds out once it's open
+bool
+TK_Session::is_fill_batch( itext::XfdfReader* xfdf_reader_p ) const
+{
+	if( m_operation!= filter_k ||
+			m_form_data_filename.empty() ||
+			m_form_data_filename== "PROMPT" )
+		return false;
+
+	if( xfdf_reader_p ) {
+		return( 1< xfdf_reader_p->getRecordCount() );
+	}
+	return( m_form_data_filename!= "-" &&
+					( is_directory( m_form_data_filename ) ||
+						ends_with_nocase( m_form_data_filename, ".csv" ) ) );
+}
+
+// true iff pattern holds exactly one %d or %0Nd and no other '%', so
+// it's safe to give snprintf() as a format with one int argument;
+// burst numbers its output files with the same kind of pattern
+bool
+is_record_pattern( const string& pattern )
+{
+	int num_conversions= 0;
+	for( string::size_type ii= pattern.find( '%' ); ii!= string::npos; ii= pattern.find( '%', ii ) ) {
+		++ii;
+		if( ii< pattern.size() && pattern[ii]== '0' ) { // zero-padded to a width
+			++ii;
+			string::size_type digits= ii;
+			while( ii< pattern.size() && isdigit( (unsigned char)pattern[ii] ) && ii- digits< 3 ) {
+				++ii;
+			}
+			if( ii== digits ) {
+				return false;
+			}
+		}
+		if( ii< pattern.size() && pattern[ii]== 'd' ) {
+			++num_conversions;
+		}
+		else {
+			return false;
+		}
+	}
+	return( num_conversions== 1 );
+}
+
+////
+// the state shared by the workers of a batch fill_form
+
+struct FillBatch {
+	itext::PdfReader* m_template_p; // only read, never changed, while workers run
+	FormRecords* m_records_p;
+	size_t m_num_records;
+	jbyteArray m_output_user_pw_p;
+	jbyteArray m_output_owner_pw_p;
+	TK_Session* m_session_p;
+
+	java::lang::Object* m_lock_p; // guards the members below, and cerr
+	size_t m_next_record;
+	size_t m_num_filled;
+};
+
+bool
+TK_Session::fill_form_record( FillBatch& batch,
+															size_t ii )
+{
+	FormRecords& records= *batch.m_records_p;
+	jbyteArray output_user_pw_p= batch.m_output_user_pw_p;
+	jbyteArray output_owner_pw_p= batch.m_output_owner_pw_p;
+
+	// the output filename
+	char buff[4096]= "";
+	snprintf( buff, sizeof(buff), m_output_filename.c_str(), (int)( ii+ 1 ) );
+
+	itext::OutputSink* ofs_p= 0;
+	try {
+		// a copy of the parsed template is much cheaper than parsing it again
+		itext::PdfReader* input_reader_p= new itext::PdfReader( batch.m_template_p );
+
+		ofs_p= open_output_sink( new java::FileOutputStream( JvNewStringUTF( buff ) ) );
+
+		jchar output_version= 0; // keep the input's version
+		jchar min_version= output_min_version( m_output_compress_objects_b );
+		if( input_reader_p->getPdfVersion()< min_version )
+			output_version= min_version;
+
+		itext::PdfStamperImp* writer_p=
+			new itext::PdfStamperImp( input_reader_p, ofs_p, output_version, false );
+
+		if( m_output_compress_objects_b ) {
+			writer_p->fullCompression= true;
+			writer_p->setObjectsPerStream( m_output_objects_per_stream );
+		}
+
+		itext::PdfDictionary* acro_form_p= 0;
+		itext::PdfDictionary* catalog_p= input_reader_p->catalog;
+		if( catalog_p && catalog_p->isDictionary() ) {
+			acro_form_p= (itext::PdfDictionary*)
+				input_reader_p->getPdfObject( catalog_p->get( itext::PdfName::ACROFORM ) );
+			if( acro_form_p && !acro_form_p->isDictionary() ) {
+				acro_form_p= 0;
+			}
+		}
+
+		// drop the xfa?
+		if( m_output_drop_xfa_b && acro_form_p ) {
+			acro_form_p->remove( itext::PdfName::XFA );
+		}
+
+		// un/compress output streams?
+		if( m_output_uncompress_b ) {
+			writer_p->filterStreams= true;
+			writer_p->compressStreams= false;
+		}
+		else if( m_output_compress_b ) {
+			writer_p->filterStreams= false;
+			writer_p->compressStreams= true;
+		}
+
+		// encrypt output?
+		if( is_output_encrypted() )
+			{
+				writer_p->setEncryption( output_user_pw_p,
+																 output_owner_pw_p,
+																 m_output_user_perms,
+																 output_encryption_type() );
+			}
+
+		// fill form fields
+		itext::AcroFields* fields_p= writer_p->getAcroFields();
+		fields_p->setGenerateAppearances( true ); // have iText create field appearances
+		if( records.fill( ii, fields_p ) && acro_form_p ) {
+			// Rich Text input found; let Acrobat make its own appearances, too
+			acro_form_p->put( itext::PdfName::NEEDAPPEARANCES, itext::PdfBoolean::PDFTRUE );
+		}
+
+		// flatten form fields?
+		writer_p->setFormFlattening( m_output_flatten_b );
+
+		writer_p->close(); // closes ofs_p, too
+		{
+			JvSynchronize sync( batch.m_lock_p );
+			close_output_sink( ofs_p ); // for its byte count
+		}
+	}
+	catch( java::lang::Exception* e_p ) {
+		{
+			JvSynchronize sync( batch.m_lock_p );
+			cerr << "Error: failed to fill form with: " << records.label( ii ) << endl;
+			jstring msg_p= e_p->getMessage();
+			if( msg_p ) {
+				cerr << "   " << jstring_to_string( msg_p ) << endl;
+			}
+			cerr << "   No output created: " << buff << endl;
+		}
+		if( ofs_p ) {
+			try {
+				ofs_p->close();
+			}
+			catch( java::io::IOException* ioe_p ) {
+			}
+			( new java::File( JvNewStringUTF( buff ) ) )->delete$();
+		}
+		return false;
+	}
+
+	return true;
+}
+
+int
+TK_Session::fill_form_batch( itext::PdfReader* input_reader_p,
+														 jbyteArray output_user_pw_p,
+														 jbyteArray output_owner_pw_p,
+														 itext::XfdfReader* xfdf_reader_p )
+{
+	int ret_val= 0;
+
+	if( !is_record_pattern( m_output_filename ) ) {
+		cerr << "Error: to fill a form with many records, give an output filename" << endl;
+		cerr << "   pattern that numbers the records with one %d or %0Nd and no" << endl;
+		cerr << "   other '%', e.g.: output form_%04d.pdf" << endl;
+		cerr << "   No output created." << endl;
+		return 1;
+	}
+	if( !m_background_filename.empty() ||
+			!m_stamp_filename.empty() ||
+			!m_stamp_detailed_filename.empty() ||
+			!m_update_info_filename.empty() ||
+			!m_input_attach_file_filename.empty() )
+		{
+			cerr << "Error: a batch fill_form can't be combined with background," << endl;
+			cerr << "   stamp, stamp_detailed, update_info or attach_files." << endl;
+			cerr << "   No output created." << endl;
+			return 1;
+		}
+	if( m_output_incremental_b ) {
+		cerr << "Warning: incremental is ignored for a batch fill_form." << endl;
+	}
+
+	FormRecords records;
+	if( !records.load( m_form_data_filename, xfdf_reader_p ) ) {
+		cerr << "   No output created." << endl;
+		return 1;
+	}
+
+	FillBatch batch;
+	batch.m_template_p= input_reader_p;
+	batch.m_records_p= &records;
+	batch.m_num_records= records.size();
+	batch.m_output_user_pw_p= output_user_pw_p;
+	batch.m_output_owner_pw_p= output_owner_pw_p;
+	batch.m_session_p= this;
+	batch.m_lock_p= new java::lang::Object();
+	batch.m_next_record= 0;
+	batch.m_num_filled= 0;
+
+	// one worker per processor; records are independent, so this scales
+	// until the disk can't keep up
+	size_t num_workers= 1;
+#ifdef USE_PTHREADS
+	num_workers= java::Runtime::getRuntime()->availableProcessors();
+	if( batch.m_num_records< num_workers ) {
+		num_workers= batch.m_num_records;
+	}
+	if( num_workers< 1 ) {
+		num_workers= 1;
+	}
+#endif
+
+	// the workers already keep the processors busy, so don't also give
+	// each output its own deflate threads
+	jint deflate_threads= itext::PdfWriter::deflateThreads;
+	if( 1< num_workers ) {
+		itext::PdfWriter::deflateThreads= 1;
+	}
+
+	jlong start_ms= java::System::currentTimeMillis();
+
+#ifdef USE_PTHREADS
+	vector< pthread_t > workers;
+	for( size_t ii= 1; ii< num_workers; ++ii ) { // this thread is a worker, too
+		pthread_t worker;
+		if( pthread_create( &worker, 0, fill_form_worker, &batch )== 0 ) {
+			workers.push_back( worker );
+		}
+		else { // make do with what we have
+			break;
+		}
+	}
+	num_workers= workers.size()+ 1;
+#endif
+
+	try {
+		fill_form_records( batch );
+	}
+	catch( java::lang::Throwable* t_p ) { // wait for the other workers, anyhow
+		JvSynchronize sync( batch.m_lock_p );
+		cerr << "Unhandled Java Exception in a fill_form worker:" << endl;
+		t_p->printStackTrace();
+	}
+
+#ifdef USE_PTHREADS
+	for( vector< pthread_t >::iterator it= workers.begin(); it!= workers.end(); ++it ) {
+		pthread_join( *it, 0 );
+	}
+#endif
+
+	itext::PdfWriter::deflateThreads= deflate_threads;
+
+	size_t num_filled= batch.m_num_filled;
+	if( num_filled< batch.m_num_records ) {
+		ret_val= 1; // the failures were reported as they happened
+	}
+
+	if( m_verbose_reporting_b ) {
+		jlong elapsed_ms= java::System::currentTimeMillis()- start_ms;
+		cout << "Filled " << num_filled << " of " << batch.m_num_records << " records";
+		if( 0< elapsed_ms ) {
+			cout << " in " << elapsed_ms/ 1000.0 << " seconds, ";
+			cout << num_filled* 1000.0/ elapsed_ms << " records per second";
+		}
+		if( 1< num_workers ) {
+			cout << ", using " << num_workers << " threads";
+		}
+		cout << "." << endl;
+	}
+
+	return ret_val;
+}
+
+// fill records until none are left; a record that fails is reported
+// and skipped
+void
+TK_Session::fill_form_records( FillBatch& batch )
+{
+	for( ;; ) {
+		size_t ii= 0;
+		{
+			JvSynchronize sync( batch.m_lock_p );
+			if( batch.m_num_records<= batch.m_next_record ) {
+				break;
+			}
+			ii= batch.m_next_record++;
+		}
+
+		if( fill_form_record( batch, ii ) ) {
+			JvSynchronize sync( batch.m_lock_p );
+			++batch.m_num_filled;
+		}
+	}
+}
+
+#ifdef USE_PTHREADS
+// the body of each extra worker thread; arg_p is the FillBatch
+void*
+TK_Session::fill_form_worker( void* arg_p )
+{
+	FillBatch* batch_p= (FillBatch*)arg_p;
+
+	// make this thread known to the Java runtime and its collector
+	JvAttachCurrentThread( 0, 0 );
+	try {
+		batch_p->m_session_p->fill_form_records( *batch_p );
+	}
+	catch( java::lang::Throwable* t_p ) {
+		JvSynchronize sync( batch_p->m_lock_p );
+		cerr << "Unhandled Java Exception in a fill_form worker:" << endl;
+		t_p->printStackTrace();
+	}
+	JvDetachCurrentThread();
+
+	return 0;
+}
+#endif
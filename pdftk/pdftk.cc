@@ -42,16 +42,22 @@
 #include <vector>
 #include <set>
 #include <algorithm>
+#include <cstdlib>
 
 #include <unistd.h> // for access()
 
 #include <java/lang/System.h>
 #include <java/lang/ClassCastException.h>
 #include <java/lang/Throwable.h>
+#include <java/lang/RuntimeException.h>
+#include <java/lang/Runtime.h>
 #include <java/lang/String.h>
 #include <java/io/IOException.h>
 #include <java/io/PrintStream.h>
 #include <java/io/FileOutputStream.h>
+#include <java/io/InputStream.h>
+#include <java/io/FileInputStream.h>
+#include <java/io/BufferedInputStream.h>
 #include <java/util/Vector.h>
 #include <java/util/ArrayList.h>
 #include <java/util/Iterator.h>
@@ -82,9 +88,10 @@
 #include "com/lowagie/text/pdf/PdfIndirectObject.h"
 #include "com/lowagie/text/pdf/PdfFileSpecification.h"
 #include "com/lowagie/text/pdf/PdfBoolean.h"
+#include "com/lowagie/text/pdf/OutputSink.h"
 #include "org/bouncycastle/util/encoders/Base64.h"
 
-#include "com/lowagie/text/pdf/RandomAccessFileOrArray.h" // for InputStreamToArray()
+#include "com/lowagie/text/pdf/RandomAccessFileOrArray.h" // for lazy readers
 
 using namespace std;
 
@@ -153,6 +160,85 @@ prompt_for_filename( const string message,
   while( cin.get( cc ) && cc!= '\n' ) { fn+= cc; }
 }
 
+bool
+open_form_data( const string filename,
+								bool base64_values_b,
+								itext::FdfReader*& fdf_reader_p,
+								itext::XfdfReader*& xfdf_reader_p )
+{
+	// sniff the format from the first bytes, instead of handing the
+	// input to FdfReader and then, on failure, to XfdfReader; XFDF is
+	// parsed as it streams in, so stdin needn't be read into memory first
+	fdf_reader_p= 0;
+	xfdf_reader_p= 0;
+	bool stdin_b= ( filename== "-" );
+	java::InputStream* in_p= 0;
+	try {
+		if( stdin_b ) {
+			in_p= new java::BufferedInputStream( java::System::in, 0x10000 );
+		}
+		else {
+			in_p= new java::BufferedInputStream( new java::FileInputStream( JvNewStringUTF( filename.c_str() ) ), 0x10000 );
+		}
+
+		if( itext::XfdfReader::isXfdf( in_p ) ) {
+			xfdf_reader_p= new itext::XfdfReader( in_p, base64_values_b );
+		}
+		else if( stdin_b ) { // FdfReader needs random access, so this reads it all
+			fdf_reader_p= new itext::FdfReader( in_p );
+		}
+		else { // let FdfReader open the file itself
+			in_p->close();
+			in_p= 0;
+			fdf_reader_p= new itext::FdfReader( JvNewStringUTF( filename.c_str() ) );
+		}
+	}
+	catch( java::io::IOException* ioe_p ) { // file open error, or neither FDF nor XFDF
+		fdf_reader_p= 0;
+		xfdf_reader_p= 0;
+	}
+	catch( java::lang::RuntimeException* re_p ) { // XML, but not XFDF
+		fdf_reader_p= 0;
+		xfdf_reader_p= 0;
+	}
+
+	if( in_p && !stdin_b ) {
+		try {
+			in_p->close();
+		}
+		catch( java::io::IOException* ioe_p ) {
+		}
+	}
+
+	return( fdf_reader_p || xfdf_reader_p );
+}
+
+// decode the base64 values (stamp_detailed images) held in an FDF;
+// equal values share one array, as they do when XfdfReader decodes them
+static java::util::HashMap*
+fdf_fields_bytes( itext::FdfReader* fdf_reader_p )
+{
+	java::util::HashMap* ret_val= new java::util::HashMap();
+	java::util::HashMap* decoded_p= new java::util::HashMap(); // keyed by base64 text
+
+	java::util::Iterator* it= fdf_reader_p->getFields()->keySet()->iterator();
+	while( it->hasNext() ) {
+		jstring name_p= (jstring)(it->next());
+		jstring value_p= fdf_reader_p->getFieldValue( name_p );
+		if( !value_p ) {
+			continue;
+		}
+		jbyteArray bytes_p= (jbyteArray)(decoded_p->get( value_p ));
+		if( !bytes_p ) {
+			bytes_p= bouncycastle::Base64::decode( value_p );
+			decoded_p->put( value_p, bytes_p );
+		}
+		ret_val->put( name_p, bytes_p );
+	}
+
+	return ret_val;
+}
+
 bool
 TK_Session::add_reader( InputPdf* input_pdf_p,
 												bool keep_artifacts_b= false )
@@ -165,28 +251,64 @@ TK_Session::add_reader( InputPdf* input_pdf_p,
 			prompt_for_filename( "Please enter a filename for an input PDF:",
 													 input_pdf_p->m_filename );
 		}
-		if( input_pdf_p->m_password.empty() ) {
-			reader=
-				new itext::PdfReader( JvNewStringUTF( input_pdf_p->m_filename.c_str() ) );
-		}
-		else {
+		jbyteArray password= 0;
+		if( !input_pdf_p->m_password.empty() ) {
 			if( input_pdf_p->m_password== "PROMPT" ) {
 				prompt_for_password( "open", "the input PDF:\n   "+ input_pdf_p->m_filename, input_pdf_p->m_password );
 			}
-			jbyteArray password= JvNewByteArray( input_pdf_p->m_password.size() );
+			password= JvNewByteArray( input_pdf_p->m_password.size() );
 			memcpy( (char*)(elements(password)), 
 							input_pdf_p->m_password.c_str(),
 							input_pdf_p->m_password.size() );
+		}
 
+		// operations that only copy or report on input pages read the
+		// input's objects on demand, so their cost follows what they touch;
+		// filter operations change the input in place, so they parse it all
+		bool lazy_b= ( !keep_artifacts_b &&
+									 ( m_operation== cat_k ||
+										 m_operation== shuffle_k ||
+										 m_operation== burst_k ||
+										 m_operation== dump_data_k ||
+										 m_operation== dump_data_utf8_k ||
+										 m_operation== dump_data_fields_k ||
+										 m_operation== dump_data_fields_utf8_k ) );
+		if( lazy_b ) {
+			try {
+				reader=
+					new itext::PdfReader( new itext::RandomAccessFileOrArray( JvNewStringUTF( input_pdf_p->m_filename.c_str() ) ),
+																password, true );
+			}
+			catch( java::io::IOException* ioe_p ) {
+				if( ioe_p->getMessage()!= 0 &&
+						ioe_p->getMessage()->equals( JvNewStringUTF( "Bad password" ) ) )
+					{
+						throw ioe_p; // handled below
+					}
+				// damaged input; the full parse knows how to repair it
+				lazy_b= false;
+				reader= 0;
+			}
+		}
+		if( !reader ) {
+			// we need the owner password (or none), so an input opened with
+			// anything else fails on its /Encrypt dictionary, before it's parsed
 			reader= 
 				new itext::PdfReader( JvNewStringUTF( input_pdf_p->m_filename.c_str() ),
-															password );
+															password, true );
 		}
 		
 		if( !keep_artifacts_b ) {
 			// generally useful operations
-			reader->consolidateNamedDestinations();
-			reader->removeUnusedObjects();
+			if( !lazy_b ) { // would visit every page and object; PdfCopy only copies what pages reach, anyhow
+				reader->consolidateNamedDestinations();
+				reader->removeUnusedObjects();
+			}
+			else if( m_operation!= cat_k && m_operation!= shuffle_k ) {
+				// dump_data and burst report bookmarks; the links on pages
+				// are consolidated as the pages are copied
+				reader->consolidateNamedBookmarks();
+			}
 			//reader->shuffleSubsetNames(); // changes the PDF subset names, but not the PostScript font names
 		}
 
@@ -194,7 +316,7 @@ TK_Session::add_reader( InputPdf* input_pdf_p,
 
 		// keep tally of which pages have been laid claim to in this reader;
 		// when creating the final PDF, this tally will be decremented
-		input_pdf_p->m_readers.push_back( pair< set<jint>, itext::PdfReader* >( set<jint>(), reader ) );
+		input_pdf_p->m_readers.push_back( pair< multiset<jint>, itext::PdfReader* >( multiset<jint>(), reader ) );
 
 		// store in this java object so the gc can trace it
 		g_dont_collect_p->addElement( reader );
@@ -452,6 +574,19 @@ TK_Session::is_keyword( char* ss, int* keyword_len_p )
 		return attach_file_to_page_k;
 	}
 
+	// burst options
+	else if( strcmp( ss_copy, "every" )== 0 ) {
+		return every_k;
+	}
+	else if( strcmp( ss_copy, "at_bookmarks" )== 0 ||
+					 strcmp( ss_copy, "atbookmarks" )== 0 ) {
+		return at_bookmarks_k;
+	}
+	else if( strcmp( ss_copy, "at_pages" )== 0 ||
+					 strcmp( ss_copy, "atpages" )== 0 ) {
+		return at_pages_k;
+	}
+
   else if( strcmp( ss_copy, "output" )== 0 ) {
     return output_k;
   }
@@ -494,6 +629,18 @@ TK_Session::is_keyword( char* ss, int* keyword_len_p )
 					 strcmp( ss_copy, "encrypt_128_bits" )== 0 ) {
 		return encrypt_128bit_k;
 	}
+	else if( strcmp( ss_copy, "encrypt_aes128" )== 0 ||
+					 strcmp( ss_copy, "encrypt_aes_128" )== 0 ||
+					 strcmp( ss_copy, "encrypt_aes128bit" )== 0 ||
+					 strcmp( ss_copy, "encrypt_aes_128bit" )== 0 ) {
+		return encrypt_aes128_k;
+	}
+	else if( strcmp( ss_copy, "encrypt_aes256" )== 0 ||
+					 strcmp( ss_copy, "encrypt_aes_256" )== 0 ||
+					 strcmp( ss_copy, "encrypt_aes256bit" )== 0 ||
+					 strcmp( ss_copy, "encrypt_aes_256bit" )== 0 ) {
+		return encrypt_aes256_k;
+	}
 	
 	// user permissions; must follow user_perms_k;
 	else if( strcmp( ss_copy, "printing" )== 0 ) {
@@ -529,18 +676,39 @@ TK_Session::is_keyword( char* ss, int* keyword_len_p )
 	else if( strcmp( ss_copy, "compress" )== 0 ) {
 		return filt_compress_k;
 	}
+	else if( strcmp( ss_copy, "compress_objects" )== 0 ) {
+		return compress_objects_k;
+	}
 	else if( strcmp( ss_copy, "flatten" )== 0 ) {
 		return flatten_k;
 	}
 	else if( strcmp( ss_copy, "drop_xfa" )== 0 ) {
 		return drop_xfa_k;
 	}
+	else if( strcmp( ss_copy, "prune_resources" )== 0 ) {
+		return prune_resources_k;
+	}
+	else if( strcmp( ss_copy, "dedup_objects" )== 0 ) {
+		return dedup_objects_k;
+	}
+	else if( strcmp( ss_copy, "incremental" )== 0 ) {
+		return incremental_k;
+	}
 	else if( strcmp( ss_copy, "keep_first_id" )== 0 ) {
 		return keep_first_id_k;
 	}
 	else if( strcmp( ss_copy, "keep_final_id" )== 0 ) {
 		return keep_final_id_k;
 	}
+	else if( strcmp( ss_copy, "buffer_size" )== 0 ) {
+		return buffer_size_k;
+	}
+	else if( strcmp( ss_copy, "fsync" )== 0 ) {
+		return fsync_k;
+	}
+	else if( strcmp( ss_copy, "serial_read" )== 0 ) {
+		return serial_read_k;
+	}
 	else if( strcmp( ss_copy, "verbose" )== 0 ) {
 		return verbose_k;
 	}
@@ -586,6 +754,44 @@ TK_Session::is_valid() const
 					  !m_output_filename.empty() ) );
 }
 
+bool
+TK_Session::is_output_encrypted() const
+{
+	return( m_output_encryption_strength!= none_enc ||
+					!m_output_owner_pw.empty() ||
+					!m_output_user_pw.empty() );
+}
+
+jint
+TK_Session::output_encryption_type() const
+{
+	switch( m_output_encryption_strength ) {
+	case bits40_enc:
+		return itext::PdfWriter::STANDARD_ENCRYPTION_40;
+	case aes128_enc:
+		return itext::PdfWriter::ENCRYPTION_AES_128;
+	case aes256_enc:
+		return itext::PdfWriter::ENCRYPTION_AES_256;
+	default: // none_enc defaults to 128 bit
+		return itext::PdfWriter::STANDARD_ENCRYPTION_128;
+	}
+}
+
+jchar
+TK_Session::output_min_version( bool compress_objects_b ) const
+{
+	jchar min_version= 0;
+	if( compress_objects_b )
+		min_version= itext::PdfWriter::VERSION_1_5;
+	if( is_output_encrypted() ) { // AES needs a newer header; RC4 doesn't
+		if( m_output_encryption_strength== aes128_enc )
+			min_version= itext::PdfWriter::VERSION_1_6;
+		else if( m_output_encryption_strength== aes256_enc )
+			min_version= itext::PdfWriter::VERSION_1_7;
+	}
+	return min_version;
+}
+
 void
 TK_Session::dump_session_data() const
 {
@@ -702,9 +908,7 @@ TK_Session::dump_session_data() const
 	// output encryption
 	cout << endl;
 	bool output_encrypted_b= 
-		m_output_encryption_strength!= none_enc ||
-		!m_output_user_pw.empty() ||
-		!m_output_owner_pw.empty();
+		is_output_encrypted();
 
 	cout << "Output PDF encryption settings:" << endl;
 	if( output_encrypted_b ) {
@@ -720,6 +924,12 @@ TK_Session::dump_session_data() const
 		case bits128_enc:
 			cout << "   Given output encryption strength: 128 bits" << endl;
 			break;
+		case aes128_enc:
+			cout << "   Given output encryption strength: 128 bits, AES" << endl;
+			break;
+		case aes256_enc:
+			cout << "   Given output encryption strength: 256 bits, AES" << endl;
+			break;
 		}
 
 		cout << endl;
@@ -826,24 +1036,54 @@ TK_Session::handle_some_output_options( TK_Session::keyword kw, ArgState* arg_st
 	case encrypt_128bit_k:
 		m_output_encryption_strength= bits128_enc;
 		break;
+	case encrypt_aes128_k:
+		m_output_encryption_strength= aes128_enc;
+		break;
+	case encrypt_aes256_k:
+		m_output_encryption_strength= aes256_enc;
+		break;
 	case filt_uncompress_k:
 		m_output_uncompress_b= true;
 		break;
 	case filt_compress_k:
 		m_output_compress_b= true;
 		break;
+	case compress_objects_k:
+		m_output_compress_objects_b= true;
+		// change state; an objects-per-stream count may follow
+		*arg_state_p= output_compress_objects_e;
+		break;
 	case flatten_k:
 		m_output_flatten_b= true;
 		break;
 	case drop_xfa_k:
 		m_output_drop_xfa_b= true;
 		break;
+	case prune_resources_k:
+		m_output_prune_resources_b= true;
+		break;
+	case dedup_objects_k:
+		m_output_dedup_objects_b= true;
+		break;
+	case incremental_k:
+		m_output_incremental_b= true;
+		break;
 	case keep_first_id_k:
 		m_output_keep_first_id_b= true;
 		break;
 	case keep_final_id_k:
 		m_output_keep_final_id_b= true;
 		break;
+	case buffer_size_k:
+		// change state
+		*arg_state_p= output_buffer_size_e;
+		break;
+	case fsync_k:
+		m_output_fsync_b= true;
+		break;
+	case serial_read_k:
+		// main() saw this before any input was read; nothing more to do
+		break;
 	case verbose_k:
 		m_verbose_reporting_b= true;
 		break;
@@ -890,6 +1130,9 @@ TK_Session::TK_Session( int argc,
  	m_update_xmp_filename(),
  	m_operation( none_k ),
  	m_page_seq(),
+	m_burst_every( 1 ),
+	m_burst_at_bookmarks_b( false ),
+	m_burst_at_pages_filename(),
  	m_form_data_filename(),
  	m_background_filename(),
  	m_stamp_filename(),
@@ -903,10 +1146,18 @@ TK_Session::TK_Session( int argc,
  	m_multibackground_b ( false ),
  	m_output_uncompress_b( false ),
  	m_output_compress_b( false ),
+ 	m_output_compress_objects_b( false ),
+ 	m_output_objects_per_stream( 200 ),
  	m_output_flatten_b( false ),
  	m_output_drop_xfa_b( false ),
+ 	m_output_prune_resources_b( false ),
+ 	m_output_dedup_objects_b( false ),
+ 	m_output_incremental_b( false ),
  	m_output_keep_first_id_b( false ),
  	m_output_keep_final_id_b( false ),
+	m_output_buffer_size( 0 ),
+	m_output_fsync_b( false ),
+	m_output_bytes( 0 ),
 	m_output_encryption_strength( none_enc )
 {
 	TK_Session::ArgState arg_state = input_files_e;
@@ -967,7 +1218,7 @@ TK_Session::TK_Session( int argc,
       }
       else if( arg_keyword== burst_k ) {
 				m_operation= burst_k;
-				arg_state= output_args_e; // makes "output <fn>" bit optional
+				arg_state= burst_args_e; // makes "output <fn>" bit optional
       }
 			else if( arg_keyword== filter_k ) {
 				m_operation= filter_k;
@@ -1470,19 +1721,26 @@ TK_Session::TK_Session( int argc,
 
 									// look to see if this page of this document
 									// has already been referenced; if it has,
-									// create a new reader; associate this page
-									// with a reader;
+									// and PdfCopy can't clone it, then create a
+									// new reader; associate this page with a reader;
 									//
-									vector< pair< set<jint>, itext::PdfReader* > >::iterator it=
+									vector< pair< multiset<jint>, itext::PdfReader* > >::iterator it=
 										m_input_pdf[range_pdf_index].m_readers.begin();
 									for( ; it!= m_input_pdf[range_pdf_index].m_readers.end(); ++it ) {
-										set<jint>::iterator jt= it->first.find( kk );
+										multiset<jint>::iterator jt= it->first.find( kk );
 										if( jt== it->first.end() ) { // kk not assoc. w/ this reader
 											it->first.insert( kk ); // create association
 											break;
 										}
 									}
 									//
+									if( it== m_input_pdf[range_pdf_index].m_readers.end() &&
+											itext::PdfCopy::isPageClonable( m_input_pdf[range_pdf_index].m_readers.front().second, (jint)kk ) )
+										{ // output kk again from the first reader, without re-parsing the file
+											it= m_input_pdf[range_pdf_index].m_readers.begin();
+											it->first.insert( kk );
+										}
+									//
 									if( it== m_input_pdf[range_pdf_index].m_readers.end() ) {
 										// need to create a new reader for kk
 										if( add_reader( &(m_input_pdf[range_pdf_index]) ) ) {
@@ -1747,6 +2005,66 @@ TK_Session::TK_Session( int argc,
 		}
 		break;
 
+		case burst_args_e: {
+			// an optional burst chunking policy, then the output section
+			if( arg_keyword== every_k ) {
+				arg_state= burst_every_e;
+			}
+			else if( arg_keyword== at_bookmarks_k ) {
+				m_burst_at_bookmarks_b= true;
+				arg_state= output_args_e;
+			}
+			else if( arg_keyword== at_pages_k ) {
+				arg_state= burst_at_pages_e;
+			}
+			else if( handle_some_output_options( arg_keyword, &arg_state ) ) {
+				break;
+			}
+			else {
+				cerr << "Error: Unexpected data in output section: " << endl;
+				cerr << "      " << argv[ii] << endl;
+				cerr << "Exiting." << endl;
+				fail_b= true;
+				break;
+			}
+		}
+		break;
+
+		case burst_every_e: {
+			// the pages per part
+			char* end_p= 0;
+			long count= strtol( argv[ii], &end_p, 10 );
+			if( arg_keyword== none_k && *argv[ii] && !*end_p && 0< count && count<= 0x7fffffff ) {
+				m_burst_every= (jint)count;
+			}
+			else { // error
+				cerr << "Error: Unexpected data after burst every: " << endl;
+				cerr << "      " << argv[ii] << endl;
+				cerr << "   every takes a positive number of pages per part." << endl;
+				cerr << "Exiting." << endl;
+				fail_b= true;
+				break;
+			}
+
+			arg_state= output_args_e;
+		}
+		break;
+
+		case burst_at_pages_e: {
+			if( arg_keyword== none_k ) {
+				m_burst_at_pages_filename= argv[ii];
+			}
+			else { // error
+				cerr << "Error: expecting a filename after burst at_pages.  Instead, I got:" << endl;
+				cerr << "   " << argv[ii] << endl;
+				fail_b= true;
+				break;
+			}
+
+			arg_state= output_args_e;
+		}
+		break;
+
 		case output_args_e: {
 			// output args are order-independent but must follow "output <fn>", if present;
 			// we are expecting any of these keywords:
@@ -1902,6 +2220,55 @@ TK_Session::TK_Session( int argc,
 		}
 		break;
 
+		case output_compress_objects_e: {
+			// the objects-per-stream count is optional
+			if( handle_some_output_options( arg_keyword, &arg_state ) ) {
+				break;
+			}
+
+			char* end_p= 0;
+			long count= strtol( argv[ii], &end_p, 10 );
+			if( arg_keyword== none_k && *argv[ii] && !*end_p && 0< count ) {
+				m_output_objects_per_stream= (jint)count;
+			}
+			else { // error
+				cerr << "Error: Unexpected data in output section: " << endl;
+				cerr << "      " << argv[ii] << endl;
+				cerr << "   compress_objects takes an optional, positive number" << endl;
+				cerr << "   of objects per object stream." << endl;
+				cerr << "Exiting." << endl;
+				fail_b= true;
+				break;
+			}
+
+			// revert state
+			arg_state= output_args_e;
+		}
+		break;
+
+		case output_buffer_size_e: {
+			// the output buffer size, in KB
+			char* end_p= 0;
+			long size_kb= strtol( argv[ii], &end_p, 10 );
+			if( arg_keyword== none_k && *argv[ii] && !*end_p &&
+					0< size_kb && size_kb< 0x200000 ) // keep bytes within a jint
+				{
+					m_output_buffer_size= (jint)( size_kb* 1024 );
+				}
+			else { // error
+				cerr << "Error: Unexpected data in output section: " << endl;
+				cerr << "      " << argv[ii] << endl;
+				cerr << "   buffer_size takes a positive size in kilobytes." << endl;
+				cerr << "Exiting." << endl;
+				fail_b= true;
+				break;
+			}
+
+			// revert state
+			arg_state= output_args_e;
+		}
+		break;
+
 		case background_filename_e : {
 			if( arg_keyword== none_k ) {
 				if( m_background_filename.empty() ) {
@@ -2074,6 +2441,25 @@ get_output_stream( string output_filename,
 	return os_p;
 }
 
+itext::OutputSink*
+TK_Session::open_output_sink( java::OutputStream* os_p )
+{
+	if( !os_p )
+		return 0;
+
+	// one large buffer in front of the file; PdfWriter writes in tiny pieces
+	return new itext::OutputSink( os_p, m_output_buffer_size, m_output_fsync_b );
+}
+
+void
+TK_Session::close_output_sink( itext::OutputSink* sink_p )
+{
+	if( sink_p ) {
+		sink_p->close(); // a no-op if the writer already closed it
+		m_output_bytes+= sink_p->getCount();
+	}
+}
+
 ////
 // when uncompressing a PDF, we add this marker to every page,
 // so the PDF is easier to navigate; when compressing a PDF,
@@ -2120,6 +2506,43 @@ remove_marks_from_pages( itext::PdfReader* reader_p )
 	}
 }
 
+////
+// stamp_detailed: a widget to stamp, and the stamp data key that names it
+
+struct StampTarget {
+	jstring m_name_p; // also a key in the stamp data map, which keeps it from GC
+	jfloat m_llx, m_lly, m_urx, m_ury;
+};
+typedef map< jint, vector< StampTarget > > StampTargets; // keyed by 1-based page number
+
+// index, by page, every widget of every form field named in the
+// stamp data; one getFieldPositions() per name, instead of one per
+// name per page; a field's widgets on a page end up adjacent
+static void
+index_stamp_targets( itext::AcroFields* fields_p,
+										 java::util::HashMap* sd_map_p,
+										 StampTargets& targets )
+{
+	java::util::Iterator* it= sd_map_p->keySet()->iterator();
+	while( it->hasNext() ) {
+		jstring name_p= (jstring)(it->next());
+		jfloatArray pos_array_p= fields_p->getFieldPositions( name_p );
+		if( !pos_array_p ) { // no such field
+			continue;
+		}
+		jfloat* pos_p= elements( pos_array_p );
+		for( jint ii= 0; ii+ 4< pos_array_p->length; ii+= 5 ) {
+			StampTarget target;
+			target.m_name_p= name_p;
+			target.m_llx= pos_p[ii+ 1];
+			target.m_lly= pos_p[ii+ 2];
+			target.m_urx= pos_p[ii+ 3];
+			target.m_ury= pos_p[ii+ 4];
+			targets[ (jint)pos_p[ii] ].push_back( target );
+		}
+	}
+}
+
 int
 TK_Session::create_output_page( itext::PdfCopy* writer_p, PageRef page_ref, int output_page_count )
 {
@@ -2136,10 +2559,10 @@ TK_Session::create_output_page( itext::PdfCopy* writer_p, PageRef page_ref, int
 
 		// take the first, associated reader and then disassociate
 		itext::PdfReader* input_reader_p= 0;
-		vector< pair< set<jint>, itext::PdfReader* > >::iterator mt=
+		vector< pair< multiset<jint>, itext::PdfReader* > >::iterator mt=
 			page_pdf.m_readers.begin();
 		for( ; mt!= page_pdf.m_readers.end(); ++mt ) {
-			set<jint>::iterator nt= mt->first.find( page_ref.m_page_num );
+			multiset<jint>::iterator nt= mt->first.find( page_ref.m_page_num );
 			if( nt!= mt->first.end() ) { // assoc. found
 				input_reader_p= mt->second;
 				mt->first.erase( nt ); // remove this assoc.
@@ -2149,6 +2572,16 @@ TK_Session::create_output_page( itext::PdfCopy* writer_p, PageRef page_ref, int
 
 		if( input_reader_p ) {
 
+			// get the original rotation before we touch the page dictionary;
+			// getPageRotation() lets go of the page, which a lazy reader may re-read
+			map< PageNumber, jint >::const_iterator rt=
+				page_pdf.m_page_rotations.find( page_ref.m_page_num );
+			if( rt== page_pdf.m_page_rotations.end() ) { // first time we see this page
+				rt= page_pdf.m_page_rotations.insert
+					( pair< PageNumber, jint >( page_ref.m_page_num,
+																			input_reader_p->getPageRotation( page_ref.m_page_num ) ) ).first;
+			}
+
 			//
 			if( m_output_uncompress_b ) {
 				add_mark_to_page( input_reader_p, page_ref.m_page_num, output_page_count+ 1 );
@@ -2161,7 +2594,7 @@ TK_Session::create_output_page( itext::PdfCopy* writer_p, PageRef page_ref, int
 			itext::PdfDictionary* input_dict_page_p= input_reader_p->getPageN( page_ref.m_page_num );
 			int page_rotation= page_ref.m_page_rot;
 			if( !page_ref.m_page_abs )	{
-				page_rotation= input_reader_p->getPageRotation( page_ref.m_page_num )+ page_ref.m_page_rot;
+				page_rotation= rt->second+ page_ref.m_page_rot;
 			}
 			page_rotation= page_rotation % 360;
 			input_dict_page_p->remove( itext::PdfName::ROTATE );
@@ -2169,6 +2602,10 @@ TK_Session::create_output_page( itext::PdfCopy* writer_p, PageRef page_ref, int
 				input_dict_page_p->put( itext::PdfName::ROTATE,
 																new itext::PdfNumber( (jint)page_rotation ) );
 			}
+			input_reader_p->pinPage( page_ref.m_page_num ); // a lazy reader mustn't re-read it
+
+			// resolve named links on just the pages we copy
+			input_reader_p->consolidateNamedDestinations( page_ref.m_page_num );
 
 			//
 			itext::PdfImportedPage* page_p= 
@@ -2216,6 +2653,14 @@ TK_Session::create_output()
 			cout << endl << "Creating Output ..." << endl;
 		}
 
+		if( m_output_compress_objects_b && m_output_uncompress_b ) {
+			cerr << "Warning: object streams are always compressed, so compress_objects" << endl;
+			cerr << "   is ignored when uncompress is given." << endl;
+			m_output_compress_objects_b= false;
+		}
+		jint objstm_count= 0, objstm_objects= 0, objstm_saved= 0; // for verbose reporting
+		jint dedup_count= 0; jlong dedup_saved= 0; // ditto
+
 		string creator= "pdftk "+ string(PDFTK_VER)+ " - www.pdftk.com";
 		//string creator= "pdftk - www.pdftk.com";
 		java::String* jv_creator_p= 
@@ -2244,9 +2689,9 @@ TK_Session::create_output()
 			case shuffle_k : { // catenate pages or shuffle pages
 				itext::Document* output_doc_p= new itext::Document();
 
-				java::OutputStream* ofs_p= 
-					get_output_stream( m_output_filename, 
-														 m_ask_about_warnings_b );
+				itext::OutputSink* ofs_p= 
+					open_output_sink( get_output_stream( m_output_filename, 
+																							 m_ask_about_warnings_b ) );
 
 				if( !ofs_p ) { // file open error
 					ret_val= 1;
@@ -2266,20 +2711,31 @@ TK_Session::create_output()
 					writer_p->compressStreams= true;
 				}
 
+				// pack objects into object streams?
+				if( m_output_compress_objects_b ) {
+					writer_p->setFullCompression();
+					writer_p->setObjectsPerStream( m_output_objects_per_stream );
+				}
+
+				// copy only the resources each page uses?
+				if( m_output_prune_resources_b ) {
+					writer_p->pruneResources= true;
+				}
+
+				// write identical objects from different inputs only once?
+				if( m_output_dedup_objects_b ) {
+					writer_p->dedupObjects= true;
+				}
+
 				// encrypt output?
-				if( m_output_encryption_strength!= none_enc ||
-						!m_output_owner_pw.empty() || 
-						!m_output_user_pw.empty() )
+				if( is_output_encrypted() )
 					{
 						// if no stregth is given, default to 128 bit,
 						// (which is incompatible w/ Acrobat 4)
-						bool bit128_b=
-							( m_output_encryption_strength!= bits40_enc );
-
 						writer_p->setEncryption( output_user_pw_p,
 																		 output_owner_pw_p,
 																		 m_output_user_perms,
-																		 bit128_b );
+																		 output_encryption_type() );
 					}
 
 				// copy file ID?
@@ -2346,6 +2802,17 @@ TK_Session::create_output()
 
 				output_doc_p->close();
 				writer_p->close();
+				close_output_sink( ofs_p );
+
+				if( m_output_compress_objects_b ) {
+					objstm_count= writer_p->getObjectStreamCount();
+					objstm_objects= writer_p->getObjectStreamObjects();
+					objstm_saved= writer_p->getObjectStreamSavings();
+				}
+				if( m_output_dedup_objects_b ) {
+					dedup_count= writer_p->getDuplicateCount();
+					dedup_saved= writer_p->getDuplicateSavings();
+				}
 			}
 			break;
 			
@@ -2361,9 +2828,6 @@ TK_Session::create_output()
 				// grab the first reader, since there's only one
 				itext::PdfReader* input_reader_p= 
 					m_input_pdf.begin()->m_readers.front().second;
-				jint input_num_pages= 
-					m_input_pdf.begin()->m_num_pages;
-
 				if( m_output_filename== "PROMPT" ) {
 					prompt_for_filename( "Please enter a filename pattern for the PDF pages (e.g. pg_%04d.pdf):",
 															 m_output_filename );
@@ -2371,98 +2835,34 @@ TK_Session::create_output()
 				if( m_output_filename.empty() ) {
 					m_output_filename= "pg_%04d.pdf";
 				}
-
-				// locate the input PDF Info dictionary that holds metadata
-				itext::PdfDictionary* input_info_p= 0; {
-					itext::PdfDictionary* input_trailer_p= input_reader_p->getTrailer();
-					if( input_trailer_p && input_trailer_p->isDictionary() ) {
-						input_info_p= (itext::PdfDictionary*)
-							input_reader_p->getPdfObject( input_trailer_p->get( itext::PdfName::INFO ) );
-						if( input_info_p && input_info_p->isDictionary() ) {
-							// success
-						}
-						else {
-							input_info_p= 0;
-						}
-					}
+				// the pattern becomes snprintf()'s format, so it gets one
+				// number and nothing else
+				if( !is_burst_archive() && !is_record_pattern( m_output_filename ) ) {
+					cerr << "Error: to burst, give an output filename pattern that numbers" << endl;
+					cerr << "   the pages with one %d or %0Nd and no other '%'," << endl;
+					cerr << "   e.g.: output pg_%04d.pdf" << endl;
+					cerr << "   No output created." << endl;
+					ret_val= 1;
+					break;
 				}
 
-				for( jint ii= 0; ii< input_num_pages; ++ii ) {
-
-					// the filename
-					char buff[4096]= "";
-					sprintf( buff, m_output_filename.c_str(), ii+ 1 );
-
-					java::String* jv_output_filename_p= JvNewStringUTF( buff );
-
-					itext::Document* output_doc_p= new itext::Document();
-					java::FileOutputStream* ofs_p= new java::FileOutputStream( jv_output_filename_p );
-					itext::PdfCopy* writer_p= new itext::PdfCopy( output_doc_p, ofs_p );
-
-					output_doc_p->addCreator( jv_creator_p );
-
-					// un/compress output streams?
-					if( m_output_uncompress_b ) {
-						writer_p->filterStreams= true;
-						writer_p->compressStreams= false;
-					}
-					else if( m_output_compress_b ) {
-						writer_p->filterStreams= false;
-						writer_p->compressStreams= true;
-					}
-
-					// encrypt output?
-					if( m_output_encryption_strength!= none_enc ||
-							!m_output_owner_pw.empty() || 
-							!m_output_user_pw.empty() )
-						{
-							// if no stregth is given, default to 128 bit,
-							// (which is incompatible w/ Acrobat 4)
-							bool bit128_b=
-								( m_output_encryption_strength!= bits40_enc );
-
-							writer_p->setEncryption( output_user_pw_p,
-																			 output_owner_pw_p,
-																			 m_output_user_perms,
-																			 bit128_b );
-						}
-
-					{ // copy the Info dictionary metadata
-						if( input_info_p ) {
-							itext::PdfDictionary* writer_info_p= writer_p->getInfo();
-							itext::PdfDictionary* info_copy_p= writer_p->copyDictionary( input_info_p );
-							if( writer_info_p && info_copy_p ) {
-								writer_info_p->putAll( info_copy_p );
-							}
-						}
-						jbyteArray input_reader_xmp_p= input_reader_p->getMetadata();
-						if( input_reader_xmp_p ) {
-							writer_p->setXmpMetadata( input_reader_xmp_p );
-						}
+				// one tar or zip archive (or a tar on stdout) instead of a file per page?
+				itext::OutputSink* archive_sink_p= 0;
+				if( is_burst_archive() ) {
+					archive_sink_p=
+						open_output_sink( get_output_stream( m_output_filename,
+																								 m_ask_about_warnings_b ) );
+					if( !archive_sink_p ) { // file open error
+						ret_val= 1;
+						break;
 					}
-
-					output_doc_p->open();
-
-					itext::PdfImportedPage* page_p= 
-						writer_p->getImportedPage( input_reader_p, ii+ 1 );
-					writer_p->addPage( page_p );
-
-					output_doc_p->close();
-					writer_p->close();
-				}
-
-				////
-				// dump document data
-
-				ofstream ofs( "doc_data.txt" );
-				if( ofs ) {
-					ReportOnPdf( ofs, input_reader_p, m_output_utf8_b );
-				}
-				else { // error
-					cerr << "Error: unable to open file for output: doc_data.txt" << endl;
-					ret_val= 1;
 				}
 
+				// write the pages, on as many threads as we have processors,
+				// and the doc_data.txt report
+				ret_val= burst( input_reader_p, archive_sink_p, jv_creator_p,
+												output_user_pw_p, output_owner_pw_p,
+												objstm_count, objstm_objects, objstm_saved );
 			}
 			break;
 
@@ -2477,59 +2877,38 @@ TK_Session::create_output()
 					break;
 				}
 
-				// try opening the FDF file before we get too involved;
-				// if input is stdin ("-"), don't pass it to both the FDF and XFDF readers
+				// try opening the FDF file before we get too involved
 				itext::FdfReader* fdf_reader_p= 0;
 				itext::XfdfReader* xfdf_reader_p= 0;
 				if( m_form_data_filename== "PROMPT" ) { // handle case where user enters '-' or (empty) at the prompt
 					prompt_for_filename( "Please enter a filename for the form data:", 
 															 m_form_data_filename );
 				}
+
+				// fill the form once per record of a directory or CSV file?
+				if( is_fill_batch() ) {
+					ret_val= fill_form_batch( m_input_pdf.begin()->m_readers.front().second,
+																		output_user_pw_p,
+																		output_owner_pw_p );
+					break;
+				}
+
 				if( !m_form_data_filename.empty() ) { // we have form data to process
-					if( m_form_data_filename== "-" ) { // form data on stdin
-						JArray<jbyte>* in_arr= itext::RandomAccessFileOrArray::InputStreamToArray( java::System::in );
-						
-						// first try fdf
-						try {
-							fdf_reader_p= new itext::FdfReader( in_arr );
-						}
-						catch( java::io::IOException* ioe_p ) { // file open error
-							// maybe it's xfdf?
-							try {
-								xfdf_reader_p= new itext::XfdfReader( in_arr );
-							}
-							catch( java::io::IOException* ioe_p ) { // file open error
-								cerr << "Error: Failed to open form data file: " << endl;
-								cerr << "   " << m_form_data_filename << endl;
-								cerr << "   No output created." << endl;
-								ret_val= 1;
-								//ioe_p->printStackTrace(); // debug
-								break;
-							}
-						}
+					if( !open_form_data( m_form_data_filename, false, fdf_reader_p, xfdf_reader_p ) ) {
+						cerr << "Error: Failed to open form data file: " << endl;
+						cerr << "   " << m_form_data_filename << endl;
+						cerr << "   No output created." << endl;
+						ret_val= 1;
+						break;
 					}
-					else { // form data file
 
-						// first try fdf
-						try {
-							fdf_reader_p=
-								new itext::FdfReader( JvNewStringUTF( m_form_data_filename.c_str() ) );
-						}
-						catch( java::io::IOException* ioe_p ) { // file open error
-							// maybe it's xfdf?
-							try {
-								xfdf_reader_p=
-									new itext::XfdfReader( JvNewStringUTF( m_form_data_filename.c_str() ) );
-							}
-							catch( java::io::IOException* ioe_p ) { // file open error
-								cerr << "Error: Failed to open form data file: " << endl;
-								cerr << "   " << m_form_data_filename << endl;
-								cerr << "   No output created." << endl;
-								ret_val= 1;
-								//ioe_p->printStackTrace(); // debug
-								break;
-							}
-						}
+					// or once per record of an XFDF file?
+					if( is_fill_batch( xfdf_reader_p ) ) {
+						ret_val= fill_form_batch( m_input_pdf.begin()->m_readers.front().second,
+																			output_user_pw_p,
+																			output_owner_pw_p,
+																			xfdf_reader_p );
+						break;
 					}
 				}
 
@@ -2565,46 +2944,14 @@ TK_Session::create_output()
 						prompt_for_filename( "Please enter a filename for the detailed stamp file:", 
 																 m_stamp_detailed_filename );
 					}
-					if( m_stamp_detailed_filename== "-" ) { // stamp detail on stdin
-						JArray<jbyte>* in_arr= itext::RandomAccessFileOrArray::InputStreamToArray( java::System::in );
-						
-						// first try fdf
-						try {
-							sd_fdf_reader_p= new itext::FdfReader( in_arr );
-						}
-						catch( java::io::IOException* ioe_p ) { // file open error
-							// maybe it's xfdf?
-							try {
-								sd_xfdf_reader_p= new itext::XfdfReader( in_arr );
-							}
-							catch( java::io::IOException* ioe_p ) { // file open error
-								cerr << "Error: Failed to open detailed stamp file: " << endl;
-								cerr << "   " << m_stamp_detailed_filename << endl;
-								cerr << "   No output created." << endl;
-								break;
-							}
-						}
+					// image data is decoded from base64 as it streams in
+					if( !open_form_data( m_stamp_detailed_filename, true, sd_fdf_reader_p, sd_xfdf_reader_p ) ) {
+						cerr << "Error: Failed to open detailed stamp file: " << endl;
+						cerr << "   " << m_stamp_detailed_filename << endl;
+						cerr << "   No output created." << endl;
+						ret_val= 1;
+						break;
 					}
-					else { // detailed stamp file
-						// first try fdf
-						try {
-							sd_fdf_reader_p=
-								new itext::FdfReader( JvNewStringUTF( m_stamp_detailed_filename.c_str() ) );
-						}
-						catch( java::io::IOException* ioe_p ) { // file open error
-							// maybe it's xfdf?
-							try {
-								sd_xfdf_reader_p=
-									new itext::XfdfReader( JvNewStringUTF( m_stamp_detailed_filename.c_str() ) );
-							}
-							catch( java::io::IOException* ioe_p ) { // file open error
-								cerr << "Error: Failed to open detailed stamp file: " << endl;
-								cerr << "   " << m_stamp_detailed_filename << endl;
-								cerr << "   No output created." << endl;
-								break;
-							}
-						}
-					}					
 				}
 				//
 				// stamp
@@ -2631,9 +2978,9 @@ TK_Session::create_output()
 				}
 
 				//
-				java::OutputStream* ofs_p= 
-					get_output_stream( m_output_filename,
-														 m_ask_about_warnings_b );
+				itext::OutputSink* ofs_p= 
+					open_output_sink( get_output_stream( m_output_filename,
+																							 m_ask_about_warnings_b ) );
 				if( !ofs_p ) { // file open error
 					cerr << "Error: unable to open file for output: " << m_output_filename << endl;
 					ret_val= 1;
@@ -2644,6 +2991,51 @@ TK_Session::create_output()
 				itext::PdfReader* input_reader_p= 
 					m_input_pdf.begin()->m_readers.front().second;
 
+				// write an incremental update?  the output is then a copy of the
+				// input followed by only the objects we change
+				bool incremental_b= m_output_incremental_b;
+				if( incremental_b ) {
+					const char* reason_p= 0;
+					if( input_reader_p->isRebuilt() )
+						reason_p= "the input PDF had to be repaired";
+					else if( m_output_uncompress_b || m_output_compress_b )
+						reason_p= "compress and uncompress rewrite every stream";
+					else if( is_output_encrypted() )
+						reason_p= "an incremental update keeps the input's encryption";
+					else if( !m_input_attach_file_filename.empty() )
+						reason_p= "attach_files is not supported in incremental mode";
+
+					if( reason_p ) {
+						cerr << "Warning: writing a complete PDF instead of an incremental update," << endl;
+						cerr << "   because " << reason_p << "." << endl;
+						incremental_b= false;
+					}
+				}
+
+				// pack objects into object streams?  in an incremental update,
+				// the xref must stay the kind the input already has
+				bool compress_objects_b= m_output_compress_objects_b;
+				if( compress_objects_b && incremental_b ) {
+					cerr << "Warning: compress_objects is ignored for an incremental update." << endl;
+					compress_objects_b= false;
+				}
+
+				// the header is written on construction, so a PDF 1.5 header
+				// for object streams, or 1.6 or 1.7 for AES, must be asked for here
+				jchar output_version= 0; // keep the input's version
+				jchar min_version= output_min_version( compress_objects_b );
+				if( input_reader_p->getPdfVersion()< min_version )
+					output_version= min_version;
+
+				//
+				itext::PdfStamperImp* writer_p=
+					new itext::PdfStamperImp( input_reader_p, ofs_p, output_version, incremental_b /* append mode */ );
+
+				if( compress_objects_b ) {
+					writer_p->fullCompression= true; // setFullCompression() would rewrite the version
+					writer_p->setObjectsPerStream( m_output_objects_per_stream );
+				}
+
 				// drop the xfa?
 				if( m_output_drop_xfa_b ) {
 					itext::PdfDictionary* catalog_p= input_reader_p->catalog;
@@ -2654,14 +3046,14 @@ TK_Session::create_output()
 						if( acro_form_p && acro_form_p->isDictionary() ) {
 
 							acro_form_p->remove( itext::PdfName::XFA );
+							writer_p->markUsed( acro_form_p ); // for incremental output
+							if( !catalog_p->get( itext::PdfName::ACROFORM )->isIndirect() ) {
+								writer_p->markUsed( catalog_p ); // a direct AcroForm is written with the catalog
+							}
 						}
 					}
 				}
 
-				//
-				itext::PdfStamperImp* writer_p=
-					new itext::PdfStamperImp( input_reader_p, ofs_p, 0, false /* append mode */ );
-
 				// update the info?
 				if( m_update_info_filename== "PROMPT" ) {
 					prompt_for_filename( "Please enter an Info file filename:",
@@ -2737,20 +3129,15 @@ TK_Session::create_output()
 				}
 
 				// encrypt output?
-				if( m_output_encryption_strength!= none_enc ||
-						!m_output_owner_pw.empty() ||
-						!m_output_user_pw.empty() )
+				if( is_output_encrypted() )
 					{
 
 						// if no stregth is given, default to 128 bit,
 						// (which is incompatible w/ Acrobat 4)
-						bool bit128_b=
-							( m_output_encryption_strength!= bits40_enc );
-
 						writer_p->setEncryption( output_user_pw_p,
 																			output_owner_pw_p,
 																			m_output_user_perms,
-																			bit128_b );
+																			output_encryption_type() );
 					}
 
 				// fill form fields?
@@ -2776,6 +3163,10 @@ TK_Session::create_output()
 									if( acro_form_p && acro_form_p->isDictionary() ) {
 
 										acro_form_p->put( itext::PdfName::NEEDAPPEARANCES, itext::PdfBoolean::PDFTRUE );
+										writer_p->markUsed( acro_form_p ); // for incremental output
+										if( !catalog_p->get( itext::PdfName::ACROFORM )->isIndirect() ) {
+											writer_p->markUsed( catalog_p ); // a direct AcroForm is written with the catalog
+										}
 									}
 								}
 							}
@@ -2872,44 +3263,49 @@ TK_Session::create_output()
 				// add detailed stamping?
 				if ( sd_fdf_reader_p || 
 						sd_xfdf_reader_p ){
-					java::util::HashMap* sd_map_p= sd_fdf_reader_p ? sd_fdf_reader_p->getFields() : sd_xfdf_reader_p->getFields();
+					// decoded images, keyed by field name
+					java::util::HashMap* sd_map_p= sd_xfdf_reader_p ? sd_xfdf_reader_p->getFieldsBytes() : fdf_fields_bytes( sd_fdf_reader_p );
 					itext::AcroFields* fields_p= writer_p->getAcroFields();
 					bool valid_image_b = true;
-					jint num_pages= input_reader_p->getNumberOfPages();
-					for( jint ii= 0; ii< num_pages; ) {
-						++ii;
+
+					// images, keyed by their (shared) decoded data; stamping the same
+					// Image again references the XObject written the first time
+					java::util::HashMap* image_cache_p= new java::util::HashMap();
+
+					// visit only the pages that have widgets to stamp
+					StampTargets targets;
+					index_stamp_targets( fields_p, sd_map_p, targets );
+					for( StampTargets::const_iterator it= targets.begin(); it!= targets.end() && valid_image_b; ++it ) {
+						jint page_num= it->first;
+						const vector< StampTarget >& page_targets= it->second;
 						com::lowagie::text::pdf::PdfContentByte* content_byte_p= 
-							( background_b ) ? writer_p->getUnderContent( ii ) : writer_p->getOverContent( ii );
-						java::util::Iterator* it = sd_map_p->keySet()->iterator();
-						while (it->hasNext() && valid_image_b){
-							jstring nextKey = (jstring)(it->next());
-							if (fields_p->getField(nextKey)){
-								jfloatArray pos_array_p = (jfloatArray)(fields_p->getFieldPositions(nextKey));
-								if (elements(*pos_array_p)[0] == (jfloat)(ii))
-								{
-									try{
-										jstring imgStringEncoded= (jstring)(sd_map_p->get(nextKey));
-										jbyteArray imgArrayDecoded= org::bouncycastle::util::encoders::Base64::decode(imgStringEncoded);
-										com::lowagie::text::Image* img= com::lowagie::text::Image::getInstance(imgArrayDecoded);
-										jfloat llx = elements(*pos_array_p)[1];
-										jfloat lly = elements(*pos_array_p)[2];
-										jfloat urx = elements(*pos_array_p)[3];
-										jfloat ury = elements(*pos_array_p)[4];
-										img->scaleToFit(urx- llx, ury-lly);
-										img->setAbsolutePosition((llx+ urx- img->scaledWidth())/2, lly);
-										content_byte_p->addImage(img);
-										fields_p->removeField(nextKey, ii);
-									}
-									catch( java::io::IOException* ioe_p ) { // file open error
-										cerr << "Error: Failed to open image file: " << endl;
-										cerr << "   " << (char*)elements(((jstring)(sd_map_p->get(nextKey)))->getBytes()) << endl;
-										cerr << "   No output created." << endl;
-										valid_image_b = false;
-									}
+							( background_b ) ? writer_p->getUnderContent( page_num ) : writer_p->getOverContent( page_num );
+						for( vector< StampTarget >::const_iterator jt= page_targets.begin(); jt!= page_targets.end(); ++jt ) {
+							try{
+								jbyteArray imgArrayDecoded= (jbyteArray)(sd_map_p->get(jt->m_name_p));
+								com::lowagie::text::Image* img= (com::lowagie::text::Image*)(image_cache_p->get(imgArrayDecoded));
+								if( !img ) {
+									img= com::lowagie::text::Image::getInstance(imgArrayDecoded);
+									image_cache_p->put(imgArrayDecoded, img);
 								}
+								// addImage() reads the scale and position right away, so reusing img is safe
+								img->scaleToFit(jt->m_urx- jt->m_llx, jt->m_ury- jt->m_lly);
+								img->setAbsolutePosition((jt->m_llx+ jt->m_urx- img->scaledWidth())/2, jt->m_lly);
+								content_byte_p->addImage(img);
+							}
+							catch( java::io::IOException* ioe_p ) { // file open error
+								cerr << "Error: Failed to read the image for field: " << endl;
+								jbyteArray name_bytes_p= jt->m_name_p->getBytes();
+								cerr << "   " << string( (char*)elements( name_bytes_p ), name_bytes_p->length ) << endl;
+								cerr << "   No output created." << endl;
+								valid_image_b = false;
+								break;
+							}
+							// once all of this field's widgets on the page are stamped, remove them
+							if( jt+ 1== page_targets.end() || (jt+ 1)->m_name_p!= jt->m_name_p ) {
+								fields_p->removeField( jt->m_name_p, page_num );
 							}
 						}
-						if (!valid_image_b){ break; }
 					}
 				}
 				// attach file to document?
@@ -2920,6 +3316,13 @@ TK_Session::create_output()
 
 				// done; write output
 				writer_p->close();
+				close_output_sink( ofs_p );
+
+				if( compress_objects_b ) {
+					objstm_count= writer_p->getObjectStreamCount();
+					objstm_objects= writer_p->getObjectStreamObjects();
+					objstm_saved= writer_p->getObjectStreamSavings();
+				}
 			}
 			break;
 
@@ -2974,14 +3377,15 @@ TK_Session::create_output()
 				itext::PdfReader* input_reader_p= 
 					m_input_pdf.begin()->m_readers.front().second;
 
-				java::OutputStream* ofs_p= 
-					get_output_stream( m_output_filename, 
-														 m_ask_about_warnings_b );
+				itext::OutputSink* ofs_p= 
+					open_output_sink( get_output_stream( m_output_filename, 
+																							 m_ask_about_warnings_b ) );
 				if( ofs_p ) {
 					itext::FdfWriter* writer_p= new itext::FdfWriter();
 					input_reader_p->getAcroFields()->exportAsFdf( writer_p );
 					writer_p->writeTo( ofs_p );
 					// no writer_p->close() function
+					close_output_sink( ofs_p );
 
 					//delete writer_p; // OK? GC? -- NOT okay!
 				}
@@ -3014,6 +3418,18 @@ TK_Session::create_output()
 				ret_val= 2;
 				break;
 			}
+
+			if( m_verbose_reporting_b && 0< objstm_count ) {
+				cout << "Packed " << objstm_objects << " objects into " << objstm_count;
+				cout << " object streams, saving about " << objstm_saved << " bytes." << endl;
+			}
+			if( m_verbose_reporting_b && 0< dedup_count ) {
+				cout << "Dropped " << dedup_count << " duplicate objects, saving about ";
+				cout << (long long)dedup_saved << " bytes." << endl;
+			}
+			if( m_verbose_reporting_b && 0< m_output_bytes ) {
+				cout << "Wrote " << (long long)m_output_bytes << " bytes of output." << endl;
+			}
 		}
 		catch( java::lang::Throwable* t_p )
 			{
@@ -3033,6 +3449,7 @@ int main(int argc, char** argv)
 {
 	bool help_b= false;
 	bool version_b= false;
+	bool serial_read_b= false;
 	bool synopsis_b= ( argc== 1 );
 	int ret_val= 0; // default: no error
 
@@ -3067,6 +3484,11 @@ Bug-Debian: http://bugs.debian.org/560594
 		help_b= 
 			(strcmp( argv[ii], "--help" )== 0 || 
 			 strcmp( argv[ii], "-h" )== 0 );
+		// the inputs are read while the arguments are parsed, so this
+		// output option must take effect before TK_Session sees them
+		serial_read_b=
+			(serial_read_b ||
+			 strcmp( argv[ii], "serial_read" )== 0 );
 	}
 
 	if( help_b ) {
@@ -3093,6 +3515,15 @@ Bug-Debian: http://bugs.debian.org/560594
 			JvInitClass(&itext::PdfOutline::class$);
 			JvInitClass(&itext::PdfBoolean::class$);
 
+			// inflate and parse PDF 1.5 object streams, and deflate streams
+			// for the compress option, on every processor; serial_read
+			// keeps the object streams on this thread
+			jint processors= java::lang::Runtime::getRuntime()->availableProcessors();
+			JvInitClass(&itext::PdfReader::class$);
+			itext::PdfReader::objStmThreads= serial_read_b ? 1 : processors;
+			JvInitClass(&itext::PdfWriter::class$);
+			itext::PdfWriter::deflateThreads= processors;
+
 			TK_Session tk_session( argc, argv );
 
 			tk_session.dump_session_data();
@@ -3152,12 +3583,16 @@ describe_synopsis() {
 	    [ input_pw <input PDF owner passwords | PROMPT> ]\n\
 	    [ <operation> <operation arguments> ]\n\
 	    [ output <output filename | - | PROMPT> ]\n\
-	    [ encrypt_40bit | encrypt_128bit ]\n\
+	    [ encrypt_40bit | encrypt_128bit | encrypt_aes128 | encrypt_aes256 ]\n\
 	    [ allow <permissions> ]\n\
 	    [ owner_pw <owner password | PROMPT> ]\n\
 	    [ user_pw <user password | PROMPT> ]\n\
 	    [ flatten ] [ compress | uncompress ]\n\
+	    [ compress_objects [<objects per stream>] ]\n\
 	    [ keep_first_id | keep_final_id ] [ drop_xfa ]\n\
+	    [ prune_resources ] [ dedup_objects ]\n\
+	    [ incremental ]\n\
+	    [ buffer_size <KB> ] [ fsync ] [ serial_read ]\n\
 	    [ verbose ] [ dont_ask | do_ask ]\n\
        Where:\n\
 	    <operation> may be empty, or:\n\
@@ -3329,13 +3764,33 @@ OPTIONS\n\
 		 the output from dump_data.  If the output section is omitted,\n\
 		 then PDF pages are named: pg_%04d.pdf, e.g.: pg_0001.pdf,\n\
 		 pg_0002.pdf, etc.  To name these pages yourself, supply a\n\
-		 printf-styled format string via the output section.  For\n\
-		 example, if you want pages named: page_01.pdf, page_02.pdf,\n\
-		 etc., pass output page_%02d.pdf to pdftk.  Encryption can be\n\
-		 applied to the output by appending output options such as\n\
-		 owner_pw, e.g.:\n\
+		 filename pattern with one %d or %0Nd, and no other '%', via\n\
+		 the output section.  For example, if you want pages named:\n\
+		 page_01.pdf, page_02.pdf, etc., pass output page_%02d.pdf to\n\
+		 pdftk.  Encryption can be applied to the output by appending\n\
+		 output options such as owner_pw, e.g.:\n\
 \n\
 		 pdftk in.pdf burst owner_pw foopass\n\
+\n\
+		 Pages are written in parallel, one thread per processor, each\n\
+		 thread with its own reader of the input.  With verbose, pdftk\n\
+		 reports how long the burst took.\n\
+\n\
+		 To split the input into parts of many pages instead, follow\n\
+		 burst with: every <N> for parts of N pages; at_bookmarks for\n\
+		 a part at each top-level bookmark; or at_pages <file> for a\n\
+		 part at each page number listed in the file, separated by\n\
+		 whitespace.  Each part is one PDF, numbered from 1 by the\n\
+		 output pattern, e.g.:\n\
+\n\
+		 pdftk in.pdf burst every 10 output part_%03d.pdf\n\
+\n\
+		 To write the pages and doc_data.txt into a single, uncom-\n\
+		 pressed archive instead, give an output filename ending in\n\
+		 .tar or .zip, or - for a tar on stdout.  The pages are named\n\
+		 pg_%04d.pdf inside the archive:\n\
+\n\
+		 pdftk in.pdf burst output pages.tar\n\
 \n\
 	  generate_fdf\n\
 		 Reads a single, input PDF file and generates an FDF file\n\
@@ -3373,6 +3828,19 @@ OPTIONS\n\
 		 instead.  If you flatten this form before Acrobat has a\n\
 		 chance to create (and save) new field appearances, then the\n\
 		 plain text field data is what you'll see.\n\
+\n\
+		 To fill many copies of a form in one run, give a directory\n\
+		 of FDF and XFDF files, an XFDF file with one <fields> ele-\n\
+		 ment per record, or a CSV file whose first row names the\n\
+		 form fields, and an output filename pattern with one %d or\n\
+		 %0Nd.  Each record is filled into its own output PDF,\n\
+		 numbered from 1; the form is read only once, and records are\n\
+		 filled in parallel, one thread per processor:\n\
+\n\
+		 pdftk form.pdf fill_form records.csv output form_%04d.pdf\n\
+\n\
+		 A record that fails is reported and skipped.  With verbose,\n\
+		 pdftk reports how many records it filled per second.\n\
 \n\
 	  background <background PDF filename | - | PROMPT>\n\
 		 Applies a PDF watermark to the background of a single input\n\
@@ -3480,13 +3948,16 @@ OPTIONS\n\
 	      operation, use output to set the name of the output data file.\n\
 	      When using the unpack_files operation, use output to set the\n\
 	      name of an output directory.  When using the burst operation,\n\
-	      you can use output to control the resulting PDF page filenames\n\
-	      (described above).\n\
+	      you can use output to control the resulting PDF page filenames,\n\
+	      or to name a .tar or .zip archive to hold them (described\n\
+	      above).\n\
 \n\
-       [encrypt_40bit | encrypt_128bit]\n\
+       [encrypt_40bit | encrypt_128bit | encrypt_aes128 | encrypt_aes256]\n\
 	      If an output PDF user or owner password is given, output PDF\n\
 	      encryption strength defaults to 128 bits.  This can be overrid-\n\
-	      den by specifying encrypt_40bit.\n\
+	      den by specifying encrypt_40bit.  encrypt_aes128 and\n\
+	      encrypt_aes256 use AES in place of RC4; they raise the output\n\
+	      PDF version to 1.6 and 1.7 (Acrobat 7 and 9), respectively.\n\
 \n\
        [allow <permissions>]\n\
 	      Permissions are applied to the output PDF only if an encryption\n\
@@ -3535,6 +4006,16 @@ OPTIONS\n\
 	      editor like vim or emacs.  Remove PDF page stream compression by\n\
 	      applying the uncompress filter. Use the compress filter to\n\
 	      restore compression.\n\
+\n\
+       [compress_objects [<objects per stream>]]\n\
+	      Pack the output's small objects (dictionaries, arrays, numbers\n\
+	      and so on) into compressed object streams and write a compressed\n\
+	      xref stream instead of an xref table.  This makes text-heavy PDFs\n\
+	      much smaller, and makes the output a PDF 1.5 document.  By\n\
+	      default each object stream holds 200 objects; give a number to\n\
+	      change this.  Works with cat, shuffle, burst and filter mode.\n\
+	      Ignored with uncompress or in an incremental update.  With\n\
+	      verbose, pdftk reports roughly how many bytes were saved.\n\
 \n\
        [flatten]\n\
 	      Use this option to merge an input PDF's interactive form fields\n\
@@ -3560,10 +4041,53 @@ OPTIONS\n\
 	      This option is only useful when running pdftk on a single input\n\
 	      PDF.  When assembling a PDF from multiple inputs using pdftk,\n\
 	      any XFA data in the input is automatically omitted.\n\
+\n\
+       [prune_resources]\n\
+	      When assembling pages with cat, shuffle or burst, copy only the\n\
+	      fonts, images, forms and other named resources that each page's\n\
+	      content actually uses.  Pages often share one large resource\n\
+	      dictionary, so without this option every part of a burst or\n\
+	      every page of a cat carries all of them.  Where pdftk can't tell\n\
+	      what a page uses, it copies the page's resources unchanged.\n\
+\n\
+       [dedup_objects]\n\
+	      When assembling pages with cat or shuffle, write each font,\n\
+	      image, ICC profile or other object only once, even if several\n\
+	      inputs carry their own identical copies of it.  Useful when\n\
+	      combining many PDFs made by the same program.  pdftk compares\n\
+	      objects by a digest of their contents, so this costs a read of\n\
+	      each stream.  With verbose, pdftk reports how many duplicates\n\
+	      it dropped and roughly how many bytes that saved.\n\
+\n\
+       [incremental]\n\
+	      When filling a form, updating Info, or stamping a single input\n\
+	      PDF, write an incremental update: a copy of the input followed\n\
+	      by only the objects that changed.  This is much faster on large\n\
+	      PDFs.  The output keeps the input's encryption, so this option\n\
+	      can't be combined with the encryption, compress or uncompress\n\
+	      options, or with attach_files; in those cases, or when the input\n\
+	      had to be repaired, pdftk warns and writes a complete PDF.\n\
+\n\
+       [buffer_size <KB>]\n\
+	      pdftk collects its output in memory and writes it to disk in\n\
+	      large pieces.  The buffer holds 1024 KB by default; use this\n\
+	      option to change its size.\n\
+\n\
+       [fsync]\n\
+	      Make sure each output file has reached the disk before pdftk\n\
+	      moves on.  This is slower, but useful when a crash mustn't leave\n\
+	      a truncated PDF behind.  Has no effect on output sent to stdout.\n\
+\n\
+       [serial_read]\n\
+	      pdftk reads the compressed object streams of PDF 1.5 and newer\n\
+	      inputs on one thread per processor.  Use this option to read\n\
+	      them on a single thread instead, e.g. to keep pdftk to one\n\
+	      processor on a busy machine, or to compare its output when you\n\
+	      suspect a problem.\n\
 \n\
        [verbose]\n\
 	      By default, pdftk runs quietly. Append verbose to the end and it\n\
-	      will speak up.\n\
+	      will speak up, e.g., reporting how many bytes of output it wrote.\n\
 \n\
        [dont_ask | do_ask]\n\
 	      Depending on the compile-time settings (see ASK_ABOUT_WARNINGS),\n\
@@ -27,6 +27,9 @@
 
 */
 
+struct FillBatch; // fill_batch.cc
+struct BurstJob; // burst.cc
+
 class TK_Session {
 	
 	bool m_valid_b;
@@ -48,12 +51,17 @@ public:
 		bool m_authorized_b;
 
 		// keep track of which pages get output under which readers,
-		// because one reader mayn't output the same page twice;
-		vector< pair< set<jint>, itext::PdfReader* > > m_readers;
+		// because one reader mayn't output the same page twice,
+		// unless PdfCopy can clone the page (see PdfCopy.isPageClonable());
+		vector< pair< multiset<jint>, itext::PdfReader* > > m_readers;
+
+		// the rotation each page had before we started changing it,
+		// so relative rotations aren't compounded when a page repeats
+		map< PageNumber, jint > m_page_rotations;
 
 		PageNumber m_num_pages;
 
-		InputPdf() : m_filename(), m_password(), m_authorized_b(true), m_readers(), m_num_pages(0) {}
+		InputPdf() : m_filename(), m_password(), m_authorized_b(true), m_readers(), m_page_rotations(), m_num_pages(0) {}
 	};
 	// pack input PDF in the order they're given on the command line
 	vector< InputPdf > m_input_pdf;
@@ -107,6 +115,11 @@ public:
 		// optional attach_file argument
 		attach_file_to_page_k,
 
+		// optional burst arguments
+		every_k,
+		at_bookmarks_k,
+		at_pages_k,
+
 		// cat page range keywords
     end_k,
     even_k,
@@ -123,6 +136,8 @@ public:
 		// output arg.s, only
 		encrypt_40bit_k,
 		encrypt_128bit_k,
+		encrypt_aes128_k,
+		encrypt_aes256_k,
 
 		// user permissions
 		perm_printing_k,
@@ -138,14 +153,23 @@ public:
 		// filters
 		filt_uncompress_k,
 		filt_compress_k,
+		compress_objects_k,
 
 		// forms
 		flatten_k,
 		drop_xfa_k,
+		prune_resources_k,
+		dedup_objects_k,
+		incremental_k,
 		keep_first_id_k,
 		keep_final_id_k,
 
+		// output sink
+		buffer_size_k,
+		fsync_k,
+
 		// pdftk options
+		serial_read_k,
 		verbose_k,
 		dont_ask_k,
 		do_ask_k
@@ -168,6 +192,11 @@ public:
   };
   vector< vector< PageRef > > m_page_seq; // one vector for each given page range
 
+	// burst into parts of many pages; see burst.cc
+	jint m_burst_every; // pages per part; 1 for single pages
+	bool m_burst_at_bookmarks_b; // a part begins at each top-level bookmark
+	string m_burst_at_pages_filename; // lists the pages where parts begin
+
 	string m_form_data_filename;
 	string m_background_filename;
 	string m_stamp_filename;
@@ -181,15 +210,25 @@ public:
 	bool m_multibackground_b; // use all pages of input background PDF, not just the first
 	bool m_output_uncompress_b;
 	bool m_output_compress_b;
+	bool m_output_compress_objects_b;
+	jint m_output_objects_per_stream;
 	bool m_output_flatten_b;
 	bool m_output_drop_xfa_b;
+	bool m_output_prune_resources_b;
+	bool m_output_dedup_objects_b;
+	bool m_output_incremental_b;
 	bool m_output_keep_first_id_b;
 	bool m_output_keep_final_id_b;
+	jint m_output_buffer_size; // bytes; 0 for the OutputSink default
+	bool m_output_fsync_b;
+	jlong m_output_bytes; // written through output sinks, for verbose reporting
 
 	enum encryption_strength {
 		none_enc= 0,
 		bits40_enc,
-		bits128_enc
+		bits128_enc,
+		aes128_enc,
+		aes256_enc
 	} m_output_encryption_strength;
 
   TK_Session( int argc, 
@@ -201,6 +240,13 @@ public:
 
 	void dump_session_data() const;
 
+	// whether the output gets encrypted (i.e., setEncryption() is called),
+	// the PdfWriter encryption type for m_output_encryption_strength,
+	// and the lowest PDF version (0 for any) the output's features need
+	bool is_output_encrypted() const;
+	jint output_encryption_type() const;
+	jchar output_min_version( bool compress_objects_b ) const;
+
 	void attach_files
 	( itext::PdfReader* input_reader_p,
 		itext::PdfWriter* writer_p );
@@ -208,6 +254,27 @@ public:
 	void unpack_files
 	( itext::PdfReader* input_reader_p );
 
+	// fill_form with many records; see fill_batch.cc
+	bool is_fill_batch( itext::XfdfReader* xfdf_reader_p= 0 ) const;
+	int fill_form_batch
+	( itext::PdfReader* input_reader_p,
+		jbyteArray output_user_pw_p,
+		jbyteArray output_owner_pw_p,
+		itext::XfdfReader* xfdf_reader_p= 0 );
+
+	// burst the input into one file per page (or per part), or into one
+	// archive when archive_sink_p is given; see burst.cc
+	bool is_burst_archive() const;
+	int burst
+	( itext::PdfReader* input_reader_p,
+		itext::OutputSink* archive_sink_p,
+		java::lang::String* jv_creator_p,
+		jbyteArray output_user_pw_p,
+		jbyteArray output_owner_pw_p,
+		jint& objstm_count,
+		jint& objstm_objects,
+		jint& objstm_saved );
+
 	int create_output_page( itext::PdfCopy*, PageRef, int );
 	int create_output();
 
@@ -219,6 +286,9 @@ private:
 		expand_filter_e,
 
     page_seq_e,
+		burst_args_e,
+		burst_every_e,
+		burst_at_pages_e,
 		form_data_filename_e,
 		
 		attach_file_filename_e,
@@ -234,6 +304,8 @@ private:
 		output_owner_pw_e,
 		output_user_pw_e,
 		output_user_perms_e,
+		output_compress_objects_e,
+		output_buffer_size_e,
 
 		background_filename_e,
 		stamp_filename_e,
@@ -245,8 +317,45 @@ private:
 	// convenience function; return true iff handled
 	bool handle_some_output_options( TK_Session::keyword kw, ArgState* arg_state_p );
 
+	// wrap an output stream in a buffered, counting sink
+	itext::OutputSink* open_output_sink( java::OutputStream* os_p );
+	// close sink_p, if necessary, and add its count to m_output_bytes
+	void close_output_sink( itext::OutputSink* sink_p );
+
+	// fill a copy of the batch template with record ii; return true on success
+	bool fill_form_record( FillBatch& batch, size_t ii );
+	// fill the batch's remaining records, one at a time; run by every worker
+	void fill_form_records( FillBatch& batch );
+	// a batch worker thread's body
+	static void* fill_form_worker( void* batch_p );
+
+	// the first page of each part a burst writes, then one past the last page
+	bool get_burst_part_starts( itext::PdfReader* input_reader_p, jint num_pages,
+															vector< jint >& part_starts );
+	// write part ii of input_reader_p to its own file; return true on success
+	bool burst_part( BurstJob& job, itext::PdfReader* input_reader_p,
+									 itext::PdfDictionary* input_info_p, jint ii );
+	// write the job's remaining parts, a run at a time; run by every worker
+	void burst_parts( BurstJob& job, itext::PdfReader* input_reader_p );
+	// a burst worker thread's body
+	static void* burst_worker( void* job_p );
+
 };
 
 void
 prompt_for_filename( const string fn_name,
 										 string& fn );
+
+// true iff pattern holds exactly one %d or %0Nd and no other '%';
+// see fill_batch.cc
+bool
+is_record_pattern( const string& pattern );
+
+// open FDF or XFDF form data from filename, or from stdin given "-";
+// on success, exactly one of the readers is set; with base64_values_b,
+// XFDF values are decoded from base64 into XfdfReader::getFieldsBytes()
+bool
+open_form_data( const string filename,
+								bool base64_values_b,
+								itext::FdfReader*& fdf_reader_p,
+								itext::XfdfReader*& xfdf_reader_p );
@@ -70,10 +70,12 @@
 #include "com/lowagie/text/pdf/PdfEncryptor.h"
 #include "com/lowagie/text/pdf/PdfNameTree.h"
 #include "com/lowagie/text/pdf/FdfReader.h"
+#include "com/lowagie/text/pdf/XfdfReader.h"
 #include "com/lowagie/text/pdf/AcroFields.h"
 #include "com/lowagie/text/pdf/PdfIndirectReference.h"
 #include "com/lowagie/text/pdf/PdfIndirectObject.h"
 #include "com/lowagie/text/pdf/PdfFileSpecification.h"
+#include "com/lowagie/text/pdf/OutputSink.h"
 
 #include "com/lowagie/text/pdf/PRStream.h"
 
@@ -283,66 +285,41 @@ GetPageNumber( itext::PdfDictionary* dict_p,
 	return 0;
 }
 
-static void
-ReportOutlines( ostream& ofs, 
-								itext::PdfDictionary* outline_p,
-								int level,
-								itext::PdfReader* reader_p,
-								bool utf8_b )
+// the 1-based page number an outline item leads to;
+// zero indicates no page destination or an error
+int
+GetOutlinePageNumber( itext::PdfDictionary* outline_p,
+											itext::PdfReader* reader_p )
 {
-	// the title; HTML-compatible
-	ofs << "BookmarkTitle: ";
-	itext::PdfString* title_p= (itext::PdfString*)
-		reader_p->getPdfObject( outline_p->get( itext::PdfName::TITLE ) );
-	if( title_p && title_p->isString() ) {
+	int ret_val= 0;
+	bool fail_b= false;
 
-		OutputPdfString( ofs, title_p, utf8_b );
-		
-		ofs << endl;
-	}
-	else { // error
-		ofs << "[ERROR: TITLE NOT FOUND]" << endl;
-	}
+	// the destination object may take be in a couple different places
+	// and may take a couple, different forms
 
-	// the level; 1-based to jive with HTML heading level concept
-	ofs << "BookmarkLevel: " << level+ 1 << endl;
-
-	// page number, 1-based; 
-	// a zero value indicates no page destination or an error
-	ofs << "BookmarkPageNumber: ";
-	{
-		bool fail_b= false;
-
-		// the destination object may take be in a couple different places
-		// and may take a couple, different forms
-
-		itext::PdfObject* destination_p= 0; {
-			if( outline_p->contains( itext::PdfName::DEST ) ) {
-				destination_p=
-					reader_p->getPdfObject( outline_p->get( itext::PdfName::DEST ) );
-			}
-			else if( outline_p->contains( itext::PdfName::A ) ) {
-
-				itext::PdfDictionary* action_p= (itext::PdfDictionary*)
-					reader_p->getPdfObject( outline_p->get( itext::PdfName::A ) );
-				if( action_p && action_p->isDictionary() ) {
+	itext::PdfObject* destination_p= 0; {
+		if( outline_p->contains( itext::PdfName::DEST ) ) {
+			destination_p=
+				reader_p->getPdfObject( outline_p->get( itext::PdfName::DEST ) );
+		}
+		else if( outline_p->contains( itext::PdfName::A ) ) {
 
-					// TODO: confirm action subtype of GoTo
-					itext::PdfName* s_p= (itext::PdfName*)
-						reader_p->getPdfObject( action_p->get( itext::PdfName::S ) );
-					if( s_p && s_p->isName() ) {
+			itext::PdfDictionary* action_p= (itext::PdfDictionary*)
+				reader_p->getPdfObject( outline_p->get( itext::PdfName::A ) );
+			if( action_p && action_p->isDictionary() ) {
 
-						if( s_p->equals( itext::PdfName::GOTO ) ) {
-							destination_p=
-								reader_p->getPdfObject( action_p->get( itext::PdfName::D ) );
-						}
-						else { // immediate action is not a link in this document;
-							// not an error
+				// TODO: confirm action subtype of GoTo
+				itext::PdfName* s_p= (itext::PdfName*)
+					reader_p->getPdfObject( action_p->get( itext::PdfName::S ) );
+				if( s_p && s_p->isName() ) {
 
-							fail_b= true;
-						}
+					if( s_p->equals( itext::PdfName::GOTO ) ) {
+						destination_p=
+							reader_p->getPdfObject( action_p->get( itext::PdfName::D ) );
 					}
-					else { // error
+					else { // immediate action is not a link in this document;
+						// not an error
+
 						fail_b= true;
 					}
 				}
@@ -350,39 +327,73 @@ ReportOutlines( ostream& ofs,
 					fail_b= true;
 				}
 			}
-			else { // unexpected
+			else { // error
 				fail_b= true;
 			}
 		}
+		else { // unexpected
+			fail_b= true;
+		}
+	}
 
-		// destination is an array
-		if( destination_p && destination_p->isArray() ) {
+	// destination is an array
+	if( destination_p && destination_p->isArray() ) {
 
-			java::ArrayList* array_list_p= ((itext::PdfArray*)destination_p)->getArrayList();
-			if( array_list_p && !array_list_p->isEmpty() ) {
+		java::ArrayList* array_list_p= ((itext::PdfArray*)destination_p)->getArrayList();
+		if( array_list_p && !array_list_p->isEmpty() ) {
 
-				itext::PdfDictionary* page_p= (itext::PdfDictionary*)
-					reader_p->getPdfObject( (itext::PdfObject*)(array_list_p->get(0)) );
+			itext::PdfDictionary* page_p= (itext::PdfDictionary*)
+				reader_p->getPdfObject( (itext::PdfObject*)(array_list_p->get(0)) );
 
-				if( page_p && page_p->isDictionary() ) {
-					ofs << GetPageNumber(page_p, reader_p)+ 1 << endl;
-				}
-				else { // error
-					fail_b= true;
-				}
+			if( page_p && page_p->isDictionary() ) {
+				ret_val= GetPageNumber(page_p, reader_p)+ 1;
 			}
 			else { // error
 				fail_b= true;
 			}
-		} // TODO: named destinations handling
+		}
 		else { // error
 			fail_b= true;
 		}
+	} // TODO: named destinations handling
+	else { // error
+		fail_b= true;
+	}
 
-		if( fail_b ) { // output our 'null page reference' code
-			ofs << 0 << endl;
-		}
+	if( fail_b ) { // our 'null page reference' code
+		ret_val= 0;
+	}
+
+	return ret_val;
+}
+
+static void
+ReportOutlines( ostream& ofs, 
+								itext::PdfDictionary* outline_p,
+								int level,
+								itext::PdfReader* reader_p,
+								bool utf8_b )
+{
+	// the title; HTML-compatible
+	ofs << "BookmarkTitle: ";
+	itext::PdfString* title_p= (itext::PdfString*)
+		reader_p->getPdfObject( outline_p->get( itext::PdfName::TITLE ) );
+	if( title_p && title_p->isString() ) {
+
+		OutputPdfString( ofs, title_p, utf8_b );
+		
+		ofs << endl;
 	}
+	else { // error
+		ofs << "[ERROR: TITLE NOT FOUND]" << endl;
+	}
+
+	// the level; 1-based to jive with HTML heading level concept
+	ofs << "BookmarkLevel: " << level+ 1 << endl;
+
+	// page number, 1-based; 
+	// a zero value indicates no page destination or an error
+	ofs << "BookmarkPageNumber: " << GetOutlinePageNumber( outline_p, reader_p ) << endl;
 
 	// recurse into any children
 	if( outline_p->contains( itext::PdfName::FIRST ) ) {
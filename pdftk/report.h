@@ -32,6 +32,10 @@ ReportAcroFormFields( ostream& ofs,
 											itext::PdfReader* reader_p,
 											bool utf8_b );
 
+int
+GetOutlinePageNumber( itext::PdfDictionary* outline_p,
+											itext::PdfReader* reader_p );
+
 void
 ReportOnPdf( ostream& ofs,
 						 itext::PdfReader* reader_p,